@@ -0,0 +1,61 @@
+// Quiz page. Each attempt draws its questions from the module's bank, named
+// by the seed in the address; a long one is split into pages. The answers
+// so far travel in the address after '#', one letter per question as shown
+// ('-' if none yet), so the board keeps nothing between pages. Submit sends
+// them with the seed to the board, which grades them and keeps statistics
+// for the teacher (/quiz/stats?module=...). The reply marks each question
+// 1 (right), 0 (wrong) or - (skipped).
+function quizForm() { return document.forms['quizForm']; }
+
+function quizInput(i, value) {
+  return quizForm().querySelector("input[name='q" + i + "']" + (value ? "[value='" + value + "']" : ':checked'));
+}
+
+function quizAnswers() {
+  var f = quizForm();
+  var saved = location.hash.slice(1);
+  var total = +f.getAttribute('data-total');
+  var answers = '';
+  for (var i = 0; i < total; i++) {
+    var onPage = f.querySelector("input[name='q" + i + "']");
+    var checked = quizInput(i);
+    answers += onPage ? (checked ? checked.value : '-') : (saved.charAt(i) || '-');
+  }
+  return answers.replace(/-+$/, '');
+}
+
+function quizPage(link) {
+  location.href = link.href + '#' + quizAnswers();
+  return false;
+}
+
+function gradeQuiz() {
+  var f = quizForm();
+  var result = document.getElementById('result');
+  var x = new XMLHttpRequest();
+  x.open('POST', '/quiz/submit');
+  x.setRequestHeader('Content-Type', 'application/x-www-form-urlencoded');
+  x.onload = function () {
+    if (x.status != 200) { result.innerHTML = 'Could not submit, please try again.'; return; }
+    var r = JSON.parse(x.responseText);
+    var q = f.querySelectorAll('.q');
+    for (var i = 0; i < q.length; i++) {
+      var m = r.marks.charAt(+q[i].getAttribute('data-index'));
+      q[i].className = m == '1' ? 'q right' : m == '0' ? 'q wrong' : 'q';
+    }
+    result.innerHTML = 'Score: ' + r.score + '/' + r.total;
+  };
+  x.onerror = function () { result.innerHTML = 'Could not submit, please try again.'; };
+  x.send('module=' + encodeURIComponent(f.getAttribute('data-module')) + '&seed=' + f.getAttribute('data-seed') +
+         '&answers=' + quizAnswers());
+}
+
+// Coming back to a page: check the options chosen on it before.
+(function () {
+  if (!quizForm()) return;
+  var saved = location.hash.slice(1);
+  for (var i = 0; i < saved.length; i++) {
+    var input = saved.charAt(i) != '-' && quizInput(i, saved.charAt(i));
+    if (input) input.checked = true;
+  }
+})();
@@ -0,0 +1,78 @@
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+// Decides whether the server takes on a request before any work is done for
+// it. Each request comes with an estimate of the heap it will hold at its
+// peak (page being built plus its copy in the output buffer); it is turned
+// away with 503 if responses already waiting to be sent exceed the queue
+// bounds, or if the largest free heap block could not hold the estimate and
+// still leave a reserve for Wi-Fi and lwIP. Shedding early keeps the board
+// answering when a whole class connects at once instead of resetting on a
+// failed allocation halfway through a page.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Responses built but not yet sent, and the bytes they hold. Override with
+// -D... in build_flags.
+#ifndef ADMISSION_MAX_QUEUED
+#define ADMISSION_MAX_QUEUED 6
+#endif
+#ifndef ADMISSION_QUEUE_BYTES
+#define ADMISSION_QUEUE_BYTES 49152
+#endif
+// Largest heap block that must remain after a request's estimate.
+#ifndef ADMISSION_HEAP_RESERVE
+#define ADMISSION_HEAP_RESERVE 16384
+#endif
+// Estimate for routes that give none: a short page or a redirect.
+#ifndef ADMISSION_DEFAULT_COST
+#define ADMISSION_DEFAULT_COST 1024
+#endif
+// Seconds a turned-away client is asked to wait before trying again.
+#ifndef ADMISSION_RETRY_AFTER_S
+#define ADMISSION_RETRY_AFTER_S 2
+#endif
+
+struct AdmissionStats {
+  uint32_t admitted;
+  uint32_t shedQueue;  // Too many responses waiting to be sent
+  uint32_t shedBytes;  // Waiting responses plus this one over the byte bound
+  uint32_t shedHeap;   // Not enough heap left for this one
+  uint32_t peakQueued;
+  size_t peakQueuedBytes;
+  size_t largestCost;  // Highest estimate admitted
+};
+
+// Returns the largest block the heap can currently hand out.
+typedef uint32_t (*HeapProbe)();
+
+class AdmissionControl {
+private:
+  HeapProbe largestBlock;
+  AdmissionStats stats;
+
+public:
+  explicit AdmissionControl(HeapProbe probe) : largestBlock(probe) { memset(&stats, 0, sizeof(stats)); }
+
+  // queued and queuedBytes describe the responses still waiting on other
+  // connections; cost is this request's estimate in bytes.
+  bool admit(size_t cost, uint32_t queued, size_t queuedBytes) {
+    if (queued > stats.peakQueued) stats.peakQueued = queued;
+    if (queuedBytes > stats.peakQueuedBytes) stats.peakQueuedBytes = queuedBytes;
+    if (queued >= ADMISSION_MAX_QUEUED) { stats.shedQueue++; return false; }
+    // A lone request is let through whatever its size, or a big lesson
+    // could never be served at all
+    if (queued > 0 && queuedBytes + cost > ADMISSION_QUEUE_BYTES) { stats.shedBytes++; return false; }
+    if (largestBlock && largestBlock() < cost + ADMISSION_HEAP_RESERVE) { stats.shedHeap++; return false; }
+    stats.admitted++;
+    if (cost > stats.largestCost) stats.largestCost = cost;
+    return true;
+  }
+
+  uint32_t shed() const { return stats.shedQueue + stats.shedBytes + stats.shedHeap; }
+  const AdmissionStats& getStats() const { return stats; }
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "content_format.h"
+
+#ifndef ARENA_BLOCK_SIZE
+#define ARENA_BLOCK_SIZE 2048
+#endif
+
+// Bump allocator for everything one content load produces. Allocations are
+// never freed one by one: reset() drops all blocks at once, so a reload
+// returns a few large blocks to the heap instead of thousands of small ones.
+// Blocks never move, so pointers into the arena stay valid until reset().
+class Arena {
+private:
+  struct Block {
+    Block* next;
+    size_t size;
+    size_t used;
+  };
+
+  Block* head;
+  size_t reserved;
+  size_t used;
+  uint32_t blocks;
+
+  static char* payload(Block* b) { return (char*)(b + 1); }
+
+public:
+  Arena() : head(nullptr), reserved(0), used(0), blocks(0) {}
+  ~Arena() { reset(); }
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Returns n bytes aligned to align (a power of two), or nullptr.
+  void* alloc(size_t n, size_t align = 4) {
+    if (head) {
+      size_t start = (head->used + align - 1) & ~(align - 1);
+      if (start + n <= head->size) {
+        head->used = start + n;
+        used += n;
+        return payload(head) + start;
+      }
+    }
+    size_t size = n > ARENA_BLOCK_SIZE ? n : ARENA_BLOCK_SIZE;
+    Block* b = (Block*)malloc(sizeof(Block) + size);
+    if (!b) return nullptr;
+    b->next = head;
+    b->size = size;
+    b->used = n;
+    head = b;
+    reserved += sizeof(Block) + size;
+    used += n;
+    blocks++;
+    return payload(b);
+  }
+
+  template <typename T>
+  T* copyArray(const T* src, size_t count) {
+    if (count == 0) return nullptr;
+    T* dst = (T*)alloc(count * sizeof(T), alignof(T));
+    if (dst) memcpy((void*)dst, src, count * sizeof(T));
+    return dst;
+  }
+
+  // Copies text into the arena and returns a view of the copy. An empty
+  // view means the arena is out of memory (or s was empty).
+  TextSpan copy(TextSpan s) {
+    if (s.len == 0) return TextSpan();
+    char* dst = (char*)alloc(s.len, 1);
+    if (!dst) return TextSpan();
+    memcpy(dst, s.ptr, s.len);
+    return TextSpan(dst, s.len);
+  }
+
+  void reset() {
+    while (head) {
+      Block* next = head->next;
+      free(head);
+      head = next;
+    }
+    reserved = used = 0;
+    blocks = 0;
+  }
+
+  size_t bytesReserved() const { return reserved; }
+  size_t bytesUsed() const { return used; }
+  uint32_t blockCount() const { return blocks; }
+};
+
+#endif
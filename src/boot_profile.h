@@ -0,0 +1,118 @@
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+// Boot-time accounting: wall time, bytes read, HTML produced and free heap
+// around each load phase and each content file. Plain C++ like
+// content_format.h, so the firmware and tools/contentc print the same table.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef BOOT_PROFILE_MAX_FILES
+#define BOOT_PROFILE_MAX_FILES 32
+#endif
+#define BOOT_PROFILE_MAX_PHASES 8
+
+struct BootRecord {
+  char name[32];
+  uint32_t micros;     // Start time until end() is called, then elapsed time
+  uint32_t bytesRead;
+  uint32_t htmlBytes;
+  uint32_t heapBefore;
+  uint32_t heapAfter;
+};
+
+typedef uint32_t (*BootCounter)();
+
+class BootProfile {
+private:
+  BootRecord phases[BOOT_PROFILE_MAX_PHASES];
+  BootRecord files[BOOT_PROFILE_MAX_FILES];
+  BootRecord spare;      // Handed out when a table is full or recording stopped
+  uint32_t phaseCount;
+  uint32_t fileCount;
+  uint32_t droppedFiles;
+  bool done;
+  BootCounter clock;     // Microseconds
+  BootCounter freeHeap;  // Bytes, or null where heap is not measured
+
+  BootRecord& start(BootRecord& r, const char* name, size_t len) {
+    memset(&r, 0, sizeof(r));
+    if (len > sizeof(r.name) - 1) len = sizeof(r.name) - 1;
+    for (size_t i = 0; i < len; i++) r.name[i] = (name[i] == '"' || name[i] == '\\') ? '_' : name[i];
+    r.heapBefore = freeHeap ? freeHeap() : 0;
+    r.micros = clock();
+    return r;
+  }
+
+  // Files are indented under the phases, in the same columns.
+  static void row(char* line, size_t size, const BootRecord& r, bool file) {
+    snprintf(line, size, "%s%-*s %8.2f %8u %8u %8u %8u\n", file ? "  " : "", file ? 30 : 32, r.name, r.micros / 1000.0, (unsigned)r.bytesRead,
+             (unsigned)r.htmlBytes, (unsigned)r.heapBefore, (unsigned)r.heapAfter);
+  }
+
+  static void jsonRecord(char* line, size_t size, const BootRecord& r, bool last) {
+    // start() already replaced the characters JSON would need escaped
+    snprintf(line, size, "{\"name\":\"%s\",\"us\":%u,\"read\":%u,\"html\":%u,\"heapBefore\":%u,\"heapAfter\":%u}%s",
+             r.name, (unsigned)r.micros, (unsigned)r.bytesRead, (unsigned)r.htmlBytes, (unsigned)r.heapBefore,
+             (unsigned)r.heapAfter, last ? "" : ",");
+  }
+
+public:
+  BootProfile(BootCounter clockMicros, BootCounter heap) : clock(clockMicros), freeHeap(heap) { reset(); }
+
+  void reset() {
+    phaseCount = fileCount = droppedFiles = 0;
+    done = false;
+  }
+
+  // Records are filled in place: add to bytesRead/htmlBytes, then end().
+  BootRecord& beginPhase(const char* name) {
+    if (done || phaseCount == BOOT_PROFILE_MAX_PHASES) return start(spare, name, strlen(name));
+    return start(phases[phaseCount++], name, strlen(name));
+  }
+
+  BootRecord& beginFile(const char* name, size_t len) {
+    if (done) return start(spare, name, len);
+    if (fileCount == BOOT_PROFILE_MAX_FILES) { droppedFiles++; return start(spare, name, len); }
+    return start(files[fileCount++], name, len);
+  }
+
+  void end(BootRecord& r) {
+    r.micros = clock() - r.micros;
+    r.heapAfter = freeHeap ? freeHeap() : 0;
+  }
+
+  // Stops recording; later loads (reloads) do not overwrite the boot numbers.
+  void finish() { done = true; }
+  bool isFinished() const { return done; }
+
+  // Writes the table through out.print(const char*), e.g. Serial or a FILE adapter.
+  template <typename Out>
+  void printTable(Out& out) const {
+    char line[128];
+    snprintf(line, sizeof(line), "%-32s %8s %8s %8s %8s %8s\n", "phase/file", "ms", "read", "html", "heap0", "heap1");
+    out.print(line);
+    for (uint32_t i = 0; i < phaseCount; i++) { row(line, sizeof(line), phases[i], false); out.print(line); }
+    for (uint32_t i = 0; i < fileCount; i++) { row(line, sizeof(line), files[i], true); out.print(line); }
+    if (droppedFiles > 0) {
+      snprintf(line, sizeof(line), "  (%u more files not listed)\n", (unsigned)droppedFiles);
+      out.print(line);
+    }
+  }
+
+  // Appends the report as JSON to any string type with += const char*.
+  template <typename Str>
+  void appendJson(Str& out) const {
+    char line[192];
+    out += "{\"phases\":[";
+    for (uint32_t i = 0; i < phaseCount; i++) { jsonRecord(line, sizeof(line), phases[i], i + 1 == phaseCount); out += line; }
+    out += "],\"files\":[";
+    for (uint32_t i = 0; i < fileCount; i++) { jsonRecord(line, sizeof(line), files[i], i + 1 == fileCount); out += line; }
+    snprintf(line, sizeof(line), "],\"filesNotListed\":%u}", (unsigned)droppedFiles);
+    out += line;
+  }
+};
+
+#endif
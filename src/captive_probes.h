@@ -0,0 +1,64 @@
+#ifndef CAPTIVE_PROBES_H
+#define CAPTIVE_PROBES_H
+
+// Connectivity checks phones and laptops send as soon as they join the
+// hotspot, and keep sending while connected. Each is answered from a table
+// with a response fixed at compile time and sent straight from flash: no
+// route lookup, no rendering and no heap. Anything but the answer the OS
+// expects from the real internet makes it open its captive-portal sheet,
+// which then loads "/".
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "content_format.h"
+#include "http_engine.h"
+
+// Status line and headers up to, not including, the Connection header.
+#define CAPTIVE_REDIRECT "HTTP/1.1 302 Found\r\nLocation: /\r\nCache-Control: no-store\r\nContent-Length: 0\r\n"
+
+// A table entry; head is a string literal such as CAPTIVE_REDIRECT, to which
+// both Connection headers are appended at compile time.
+#define CAPTIVE_PROBE(path, head) \
+  CaptiveProbe(path, head "Connection: keep-alive\r\n\r\n", head "Connection: close\r\n\r\n")
+
+struct CaptiveProbe {
+  const char* path;
+  const char* keepAlive;  // Complete responses
+  const char* close;
+  size_t pathLength;
+  size_t keepAliveLength;
+  size_t closeLength;
+  uint32_t hits;
+
+  CaptiveProbe(const char* p, const char* k, const char* c)
+      : path(p), keepAlive(k), close(c), pathLength(strlen(p)), keepAliveLength(strlen(k)), closeLength(strlen(c)), hits(0) {}
+};
+
+class CaptiveProbes {
+private:
+  CaptiveProbe* probes;
+  int count;
+
+public:
+  CaptiveProbes(CaptiveProbe* table, int tableSize) : probes(table), count(tableSize) {}
+
+  // Writes the fixed response and returns true if req is a known probe.
+  bool answer(HttpRequest& req, HttpOutput& out) {
+    if (req.method != METHOD_GET && req.method != METHOD_HEAD) return false;
+    for (int i = 0; i < count; i++) {
+      CaptiveProbe& p = probes[i];
+      if (p.pathLength != req.path.len || memcmp(p.path, req.path.ptr, p.pathLength) != 0) continue;
+      if (req.keepAlive) out.writeFixed(p.keepAlive, p.keepAliveLength);
+      else out.writeFixed(p.close, p.closeLength);
+      p.hits++;
+      return true;
+    }
+    return false;
+  }
+
+  int size() const { return count; }
+  const CaptiveProbe& get(int i) const { return probes[i]; }
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef CHUNKED_WRITER_H
+#define CHUNKED_WRITER_H
+
+#include <stddef.h>
+#include <string.h>
+
+#ifndef HTML_CHUNK_SIZE
+#define HTML_CHUNK_SIZE 512
+#endif
+
+// Receives each flushed chunk. Called once with len == 0 to end the response.
+typedef void (*ChunkSink)(const char* data, size_t len, void* ctx);
+
+// Collects output in a fixed buffer and hands it to the sink whenever it
+// fills, so a page of any length costs HTML_CHUNK_SIZE bytes of RAM. With the
+// WebServer sink each flush becomes one HTTP chunk.
+class ChunkedWriter {
+private:
+  char buf[HTML_CHUNK_SIZE];
+  size_t used;
+  size_t total;
+  ChunkSink sink;
+  void* ctx;
+
+public:
+  ChunkedWriter(ChunkSink s, void* c) : used(0), total(0), sink(s), ctx(c) {}
+
+  void write(const char* data, size_t len) {
+    total += len;
+    while (len > 0) {
+      size_t n = HTML_CHUNK_SIZE - used;
+      if (n > len) n = len;
+      memcpy(buf + used, data, n);
+      used += n;
+      data += n;
+      len -= n;
+      if (used == HTML_CHUNK_SIZE) flush();
+    }
+  }
+
+  void write(const char* s) { write(s, strlen(s)); }
+
+  template <typename Str>
+  void write(const Str& s) { write(s.c_str(), s.length()); }
+
+  void flush() {
+    if (used == 0) return;
+    sink(buf, used, ctx);
+    used = 0;
+  }
+
+  // Flushes the remainder and signals the end of the response.
+  void finish() {
+    flush();
+    sink(buf, 0, ctx);
+  }
+
+  size_t bytesWritten() const { return total; }
+};
+
+#endif
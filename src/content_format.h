@@ -0,0 +1,359 @@
+#ifndef CONTENT_FORMAT_H
+#define CONTENT_FORMAT_H
+
+// File naming and quiz format rules, shared by the firmware (ContentParser)
+// and the host-side content compiler (tools/contentc). Plain C++ only, no
+// Arduino types, so both sides always agree on how data/ is interpreted.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <strings.h>
+
+// Options are lettered a) to z) and answered by letter, so a question has at
+// most this many; there is no other limit on options.
+#define QUIZ_OPTION_LETTERS 26
+// Largest compiled question (see quizBlockEncode); longer ones are rejected.
+#ifndef QUIZ_BLOCK_MAX
+#define QUIZ_BLOCK_MAX 1024
+#endif
+
+struct TextSpan {
+  const char* ptr;
+  size_t len;
+  TextSpan() : ptr(""), len(0) {}
+  TextSpan(const char* p, size_t n) : ptr(p), len(n) {}
+};
+
+enum ContentKind { CONTENT_NONE, CONTENT_LESSON, CONTENT_QUIZ };
+
+inline bool spanEndsWith(TextSpan s, const char* suffix) {
+  size_t n = strlen(suffix);
+  return s.len >= n && memcmp(s.ptr + s.len - n, suffix, n) == 0;
+}
+
+inline bool spanStartsWith(TextSpan s, const char* prefix) {
+  size_t n = strlen(prefix);
+  return s.len >= n && memcmp(s.ptr, prefix, n) == 0;
+}
+
+inline TextSpan spanTrim(TextSpan s) {
+  while (s.len > 0 && isspace((unsigned char)s.ptr[0])) { s.ptr++; s.len--; }
+  while (s.len > 0 && isspace((unsigned char)s.ptr[s.len - 1])) s.len--;
+  return s;
+}
+
+// The decimal number s starts with (0 if none), without copying s.
+inline uint32_t spanNumber(TextSpan s) {
+  uint32_t n = 0;
+  for (size_t i = 0; i < s.len && isdigit((unsigned char)s.ptr[i]); i++) n = n * 10 + (uint32_t)(s.ptr[i] - '0');
+  return n;
+}
+
+// Returns the index of needle in text at or after from, or -1.
+inline long spanFind(const char* text, size_t len, size_t from, const char* needle) {
+  size_t n = strlen(needle);
+  if (n == 0 || len < n) return -1;
+  for (size_t i = from; i + n <= len; i++) {
+    if (text[i] == needle[0] && memcmp(text + i, needle, n) == 0) return (long)i;
+  }
+  return -1;
+}
+
+inline ContentKind contentKindOf(TextSpan fileName) {
+  if (spanEndsWith(fileName, ".content") || spanEndsWith(fileName, ".md")) return CONTENT_LESSON;
+  if (spanEndsWith(fileName, ".quiz") || spanEndsWith(fileName, ".txt")) return CONTENT_QUIZ;
+  return CONTENT_NONE;
+}
+
+// Splits "math_1.intro.content" into module "math" and "1.intro.content".
+// Names without a prefix land in the "general" module.
+inline void splitModulePrefix(TextSpan fullName, TextSpan& moduleId, TextSpan& fileName) {
+  const char* us = (const char*)memchr(fullName.ptr, '_', fullName.len);
+  if (us && us > fullName.ptr) {
+    moduleId = TextSpan(fullName.ptr, us - fullName.ptr);
+    fileName = TextSpan(us + 1, fullName.len - (us - fullName.ptr) - 1);
+  } else {
+    moduleId = TextSpan("general", 7);
+    fileName = fullName;
+  }
+}
+
+// Extracts ID from "1.intro.content" (returns 1)
+inline int lessonIdFromName(TextSpan fileName) {
+  const char* dot = (const char*)memchr(fileName.ptr, '.', fileName.len);
+  if (dot && dot > fileName.ptr && isdigit((unsigned char)fileName.ptr[0])) return atoi(fileName.ptr);
+  return 0;
+}
+
+// Text after the first "# " up to the end of that line.
+inline TextSpan lessonTitleOf(TextSpan markdown) {
+  long start = spanFind(markdown.ptr, markdown.len, 0, "# ");
+  if (start < 0) return TextSpan("Untitled", 8);
+  start += 2;
+  long end = spanFind(markdown.ptr, markdown.len, start, "\n");
+  if (end < 0) end = (long)markdown.len;
+  return TextSpan(markdown.ptr + start, end - start);
+}
+
+// "pang-uri" -> "Pang Uri". Writes at most outSize-1 bytes plus a NUL and
+// returns the title length.
+inline size_t moduleNameInto(TextSpan moduleId, char* out, size_t outSize) {
+  size_t n = 0;
+  bool capitalizeNext = true;
+  for (size_t i = 0; i < moduleId.len && n + 1 < outSize; i++) {
+    char c = moduleId.ptr[i];
+    if (c == '-' || c == '_') { out[n++] = ' '; capitalizeNext = true; }
+    else if (capitalizeNext) { out[n++] = (char)toupper((unsigned char)c); capitalizeNext = false; }
+    else { out[n++] = (char)tolower((unsigned char)c); }
+  }
+  if (outSize > 0) out[n] = '\0';
+  return n;
+}
+
+// 32-bit FNV-1a of a file's bytes; tools/build_content.py computes the same
+// value for the manifest. Pass a previous result as seed to hash several
+// pieces as one.
+inline uint32_t contentHash(const char* data, size_t len, uint32_t seed = 2166136261u) {
+  uint32_t h = seed;
+  for (size_t i = 0; i < len; i++) { h ^= (uint8_t)data[i]; h *= 16777619u; }
+  return h;
+}
+
+inline size_t quizBlockEnd(const char* table, int i) {
+  return (uint8_t)table[2 * i] | (size_t)(uint8_t)table[2 * i + 1] << 8;
+}
+
+// A question and its options. The options are not copied anywhere: as read
+// by QuizReader they are spans of the quiz text, kept by the reader until
+// its next question; decoded from a block (quizBlockDecode) they are read
+// from the block's own offsets, however many there are.
+struct QuizQuestionSpans {
+  TextSpan question;
+  int optionCount;
+  char correctAnswer;  // 'a' for the first option
+  const TextSpan* spans;     // Parsed: one per option
+  const char* blockTable;    // Decoded: the block's end offsets
+  const char* blockText;
+
+  QuizQuestionSpans() : optionCount(0), correctAnswer(0), spans(nullptr), blockTable(nullptr), blockText(nullptr) {}
+
+  TextSpan option(int i) const {
+    if (spans) return spans[i];
+    size_t start = quizBlockEnd(blockTable, i);
+    return TextSpan(blockText + start, quizBlockEnd(blockTable, i + 1) - start);
+  }
+};
+
+// Words that start the answer line, in the languages quizzes are written in.
+static const char* const QUIZ_ANSWER_MARKERS[] = { "Answer", "Sagot", "Correct answer", "Tamang sagot" };
+
+// Called for each problem found in a quiz file; line is 1-based.
+typedef void (*QuizErrorSink)(uint32_t line, const char* message, void* ctx);
+
+// Reads the quiz format one line at a time, in a single pass:
+//
+//   ### Question 1 (2 points)    starts a question; its own text is used
+//   What is the largest island   if no question lines follow
+//   in the Philippines?          question text, any number of lines
+//   a) Cebu                      options a), b)...; a line right below an
+//   b) Luzon                     option continues it
+//   **Answer: b) Luzon**         answer line, see QUIZ_ANSWER_MARKERS
+//
+// "---" and "#"/"##" headings end a question; text outside questions
+// (titles, instructions) is skipped. Questions with problems are reported
+// to the error sink and left out.
+class QuizReader {
+private:
+  enum State { OUTSIDE, QUESTION, OPTIONS, ANSWERED };
+
+  const char* text;
+  size_t len;
+  size_t pos;
+  uint32_t line;
+  QuizErrorSink onError;
+  void* ctx;
+  uint32_t errors;
+
+  State state;
+  QuizQuestionSpans cur;
+  TextSpan options[QUIZ_OPTION_LETTERS];
+  TextSpan heading;
+  uint32_t headingLine;
+  uint32_t answerLine;
+  const char* questionEnd;  // cur.question grows up to here
+  bool broken;              // A problem was reported; drop the question
+  bool afterOption;         // Previous line was an option, so text continues it
+
+  void error(uint32_t at, const char* message) {
+    errors++;
+    broken = true;
+    if (onError) onError(at, message, ctx);
+  }
+
+  // Letter of an "x) ..." option line, or 0.
+  static char optionLetter(TextSpan t) {
+    if (t.len < 2 || t.ptr[1] != ')' || !isalpha((unsigned char)t.ptr[0])) return 0;
+    return (char)tolower((unsigned char)t.ptr[0]);
+  }
+
+  // Letter of an answer line such as "**Answer: b) Luzon**", "Sagot: c" or
+  // "**Answer:** B", or 0.
+  static char answerLetter(TextSpan t) {
+    while (t.len > 0 && (t.ptr[0] == '*' || t.ptr[0] == '_')) { t.ptr++; t.len--; }
+    for (size_t m = 0; m < sizeof(QUIZ_ANSWER_MARKERS) / sizeof(QUIZ_ANSWER_MARKERS[0]); m++) {
+      size_t n = strlen(QUIZ_ANSWER_MARKERS[m]);
+      if (t.len <= n || strncasecmp(t.ptr, QUIZ_ANSWER_MARKERS[m], n) != 0 || t.ptr[n] != ':') continue;
+      size_t i = n + 1;
+      while (i < t.len && (t.ptr[i] == ' ' || t.ptr[i] == '\t' || t.ptr[i] == '*' || t.ptr[i] == '_')) i++;
+      if (i == t.len || !isalpha((unsigned char)t.ptr[i])) return 0;
+      if (i + 1 < t.len && isalnum((unsigned char)t.ptr[i + 1])) return 0;  // A word, not a letter
+      return (char)tolower((unsigned char)t.ptr[i]);
+    }
+    return 0;
+  }
+
+  void begin(TextSpan t) {
+    state = QUESTION;
+    size_t skip = 0;
+    while (skip < t.len && t.ptr[skip] == '#') skip++;
+    heading = spanTrim(TextSpan(t.ptr + skip, t.len - skip));
+    headingLine = line;
+    cur.question = TextSpan();
+    cur.optionCount = 0;
+    cur.correctAnswer = 0;
+    cur.spans = options;
+    questionEnd = nullptr;
+    broken = false;
+    afterOption = false;
+  }
+
+  // Ends the current question; true if it is complete and goes into q.
+  bool finish(QuizQuestionSpans& q) {
+    State was = state;
+    state = OUTSIDE;
+    if (was == OUTSIDE || broken) return false;
+    if (cur.optionCount == 0) { error(headingLine, "question has no options"); return false; }
+    if (!cur.correctAnswer) { error(headingLine, "question has no answer line"); return false; }
+    if (cur.correctAnswer - 'a' >= cur.optionCount) { error(answerLine, "answer is not one of the options"); return false; }
+    if (!questionEnd) cur.question = heading;
+    q = cur;
+    return true;
+  }
+
+  void option(TextSpan t, char letter) {
+    if (letter != 'a' + cur.optionCount) { error(line, "options must go a), b), c)... in order"); return; }
+    options[cur.optionCount++] = spanTrim(TextSpan(t.ptr + 2, t.len - 2));
+    state = OPTIONS;
+    afterOption = true;
+  }
+
+public:
+  QuizReader(const char* quizText, size_t quizLen, QuizErrorSink sink = nullptr, void* sinkCtx = nullptr)
+      : text(quizText), len(quizLen), pos(0), line(0), onError(sink), ctx(sinkCtx), errors(0), state(OUTSIDE),
+        headingLine(0), answerLine(0), questionEnd(nullptr), broken(false), afterOption(false) {}
+
+  // The next complete question, or false at the end of the text. q's
+  // options stay valid until the next call.
+  bool next(QuizQuestionSpans& q) {
+    while (pos < len) {
+      const char* nl = (const char*)memchr(text + pos, '\n', len - pos);
+      size_t end = nl ? (size_t)(nl - text) : len;
+      TextSpan t = spanTrim(TextSpan(text + pos, end - pos));
+      pos = nl ? end + 1 : len;
+      line++;
+
+      if (t.len == 0) { afterOption = false; continue; }
+      if (spanStartsWith(t, "###")) {
+        bool done = finish(q);
+        begin(t);
+        if (done) return true;
+        continue;
+      }
+      if (t.ptr[0] == '#' || spanStartsWith(t, "---")) {
+        if (finish(q)) return true;
+        continue;
+      }
+      if (state == OUTSIDE || state == ANSWERED || broken) continue;
+
+      char letter = answerLetter(t);
+      if (letter) {
+        if (state == QUESTION) { error(line, "answer line before the options"); continue; }
+        cur.correctAnswer = letter;
+        answerLine = line;
+        state = ANSWERED;
+        continue;
+      }
+      letter = optionLetter(t);
+      if (letter) { option(t, letter); continue; }
+      if (state == QUESTION) {
+        if (!questionEnd) cur.question.ptr = t.ptr;
+        questionEnd = t.ptr + t.len;
+        cur.question.len = questionEnd - cur.question.ptr;
+      } else if (afterOption) {
+        TextSpan& o = options[cur.optionCount - 1];
+        o.len = t.ptr + t.len - o.ptr;
+      }
+    }
+    return finish(q);
+  }
+
+  uint32_t errorCount() const { return errors; }
+};
+
+// A question compiled for storage, so it is read back without parsing: the
+// end of the question text and of each option as little-endian uint16
+// offsets into the text, then the UTF-8 text itself, back to back. The
+// option count and answer are kept beside the block, not in it.
+//
+//   "Largest island?" "Cebu" "Luzon"  ->  15 19 24 | Largest island?CebuLuzon
+//
+// contentc writes blocks into the content pack; the firmware builds the same
+// blocks in RAM when it boots from raw quiz files.
+
+inline size_t quizBlockTableSize(int optionCount) { return 2 * (size_t)(optionCount + 1); }
+
+// Writes q's block into buf; returns its length, or 0 if it exceeds cap or
+// QUIZ_BLOCK_MAX.
+inline size_t quizBlockEncode(const QuizQuestionSpans& q, char* buf, size_t cap) {
+  size_t table = quizBlockTableSize(q.optionCount);
+  size_t textLen = q.question.len;
+  for (int i = 0; i < q.optionCount; i++) textLen += q.option(i).len;
+  if (table + textLen > cap || table + textLen > QUIZ_BLOCK_MAX) return 0;
+  char* text = buf + table;
+  size_t end = 0;
+  for (int i = 0; i <= q.optionCount; i++) {
+    TextSpan s = i == 0 ? q.question : q.option(i - 1);
+    memcpy(text + end, s.ptr, s.len);
+    end += s.len;
+    buf[2 * i] = (char)(end & 0xFF);
+    buf[2 * i + 1] = (char)(end >> 8);
+  }
+  return table + end;
+}
+
+// Points q's question and options into block, which must stay in place
+// while q is used. Checks every offset, so a damaged block is refused
+// rather than read past; q.correctAnswer is left alone.
+inline bool quizBlockDecode(const char* block, size_t len, int optionCount, QuizQuestionSpans& q) {
+  if (optionCount < 0 || optionCount > QUIZ_OPTION_LETTERS) return false;
+  size_t table = quizBlockTableSize(optionCount);
+  if (len < table || len > QUIZ_BLOCK_MAX) return false;
+  size_t start = 0;
+  for (int i = 0; i <= optionCount; i++) {
+    size_t end = quizBlockEnd(block, i);
+    if (end < start || end > len - table) return false;
+    start = end;
+  }
+  if (start != len - table) return false;
+  q.question = TextSpan(block + table, quizBlockEnd(block, 0));
+  q.optionCount = optionCount;
+  q.spans = nullptr;
+  q.blockTable = block;
+  q.blockText = block + table;
+  return true;
+}
+
+#endif
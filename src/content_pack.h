@@ -0,0 +1,118 @@
+#ifndef CONTENT_PACK_H
+#define CONTENT_PACK_H
+
+// Layout of /content.pack, the pre-rendered content image produced at build
+// time by tools/contentc. All integers are little-endian (host and ESP32).
+//
+//   PackHeader
+//   PackModule[moduleCount]
+//   PackLesson[lessonCount]      grouped by module, see PackModule::firstLesson
+//   PackQuestion[questionCount]  grouped by module, see PackModule::firstQuestion
+//   string pool                  titles and names (not NUL terminated)
+//   lesson bodies                rendered HTML, at PackLesson::bodyOffset
+//   quiz blocks                  question text, at PackQuestion::blockOffset
+//
+// Everything before the lesson bodies is the "index" (PackHeader::indexSize)
+// and is all the firmware reads at boot: quizzes cost it 8 bytes a question
+// for the answer key, their text stays in flash until a page shows it.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "content_format.h"
+
+#define CONTENT_PACK_PATH "/content.pack"
+#define CONTENT_PACK_MAGIC 0x4B503849u  // "I8PK"
+#define CONTENT_PACK_VERSION 4
+
+struct PackStr {
+  uint32_t offset;  // into the string pool
+  uint32_t length;
+};
+
+struct PackHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t moduleCount;
+  uint16_t lessonCount;
+  uint16_t questionCount;
+  uint32_t stringPoolSize;
+  uint32_t indexSize;  // header + tables + string pool
+  uint32_t bodySize;   // bytes of lesson bodies and quiz blocks after the index
+};
+
+struct PackModule {
+  PackStr id;
+  PackStr name;
+  uint16_t firstLesson;
+  uint16_t lessonCount;
+  uint16_t firstQuestion;
+  uint16_t questionCount;
+  uint32_t quizHash;  // contentHash() of the quiz source, 0 without a quiz
+};
+
+struct PackLesson {
+  int32_t id;
+  PackStr title;
+  uint32_t bodyOffset;  // absolute file offset
+  uint32_t bodyLength;
+  uint32_t hash;        // contentHash() of the Markdown source
+};
+
+struct PackQuestion {
+  uint32_t blockOffset;  // absolute file offset of the quizBlockEncode() block
+  uint16_t blockLength;
+  uint8_t optionCount;
+  uint8_t answer;        // 0 for the first option
+};
+
+static_assert(sizeof(PackHeader) == 24, "PackHeader layout");
+static_assert(sizeof(PackModule) == 28, "PackModule layout");
+static_assert(sizeof(PackLesson) == 24, "PackLesson layout");
+static_assert(sizeof(PackQuestion) == 8, "PackQuestion layout");
+
+inline size_t packModulesOffset(const PackHeader&) { return sizeof(PackHeader); }
+inline size_t packLessonsOffset(const PackHeader& h) { return packModulesOffset(h) + h.moduleCount * sizeof(PackModule); }
+inline size_t packQuestionsOffset(const PackHeader& h) { return packLessonsOffset(h) + h.lessonCount * sizeof(PackLesson); }
+inline size_t packStringsOffset(const PackHeader& h) { return packQuestionsOffset(h) + h.questionCount * sizeof(PackQuestion); }
+
+inline bool packStrValid(const PackHeader& h, const PackStr& s) {
+  return s.offset <= h.stringPoolSize && s.length <= h.stringPoolSize - s.offset;
+}
+
+// True if [offset, offset + length) lies in the data after the index.
+inline bool packBodyValid(const PackHeader& h, uint32_t offset, uint32_t length) {
+  return offset >= h.indexSize && length <= h.bodySize && offset - h.indexSize <= h.bodySize - length;
+}
+
+// Checks every table entry of an index read into memory, so the firmware can
+// trust offsets without further bounds checks. fileSize is the pack size.
+inline bool packIndexValid(const uint8_t* index, size_t indexSize, size_t fileSize) {
+  if (indexSize < sizeof(PackHeader)) return false;
+  const PackHeader& h = *(const PackHeader*)index;
+  if (h.magic != CONTENT_PACK_MAGIC || h.version != CONTENT_PACK_VERSION) return false;
+  if (h.indexSize != indexSize || packStringsOffset(h) + h.stringPoolSize != indexSize) return false;
+  if ((size_t)h.indexSize + h.bodySize > fileSize) return false;
+
+  const PackModule* mods = (const PackModule*)(index + packModulesOffset(h));
+  const PackLesson* lessons = (const PackLesson*)(index + packLessonsOffset(h));
+  const PackQuestion* questions = (const PackQuestion*)(index + packQuestionsOffset(h));
+  for (unsigned i = 0; i < h.moduleCount; i++) {
+    const PackModule& m = mods[i];
+    if (!packStrValid(h, m.id) || !packStrValid(h, m.name)) return false;
+    if ((unsigned)m.firstLesson + m.lessonCount > h.lessonCount) return false;
+    if ((unsigned)m.firstQuestion + m.questionCount > h.questionCount) return false;
+  }
+  for (unsigned i = 0; i < h.lessonCount; i++) {
+    const PackLesson& l = lessons[i];
+    if (!packStrValid(h, l.title) || !packBodyValid(h, l.bodyOffset, l.bodyLength)) return false;
+  }
+  // Block contents are checked by quizBlockDecode() when read
+  for (unsigned i = 0; i < h.questionCount; i++) {
+    const PackQuestion& q = questions[i];
+    if (!packBodyValid(h, q.blockOffset, q.blockLength) || q.blockLength > QUIZ_BLOCK_MAX) return false;
+    if (q.optionCount > QUIZ_OPTION_LETTERS || q.answer >= q.optionCount) return false;
+  }
+  return true;
+}
+
+#endif
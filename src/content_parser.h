@@ -4,149 +4,480 @@
 #include <Arduino.h>
 #include <FS.h>
 #include <SPIFFS.h>
+#include <new>
 #include "md4c-html.h"
+#include "content_format.h"
+#include "content_pack.h"
+#include "lesson_cache.h"
+#include "chunked_writer.h"
+#include "file_ingest.h"
+#include "flat_table.h"
+#include "arena.h"
+#include "boot_profile.h"
 
-#define MAX_LESSONS 10
-#define MAX_MODULES 10
-#define MAX_QUIZ_QUESTIONS 50
+// Lesson/quiz metadata with file sizes and hashes, so boot does not have to
+// open and read every file. Written at build time by tools/build_content.py
+// and rewritten here after a full scan. One tab-separated record per line
+// after the header, which gives the number of records, so a manifest cut
+// short is noticed:
+//   innov8-manifest 3 <files>
+//   L <module> <lesson id> <title> <path> <size> <hash>
+//   Q <module> <path> <size> <hash>
+// Boot trusts it without listing the files: the build writes it into the
+// same image as the files it describes. A lesson that changed is noticed
+// when it is read, a quiz when it is parsed at boot, and files added or
+// removed on the board by other means when the content is reloaded.
+#define CONTENT_MANIFEST_PATH "/content.idx"
+#define CONTENT_MANIFEST_HEADER "innov8-manifest 3"
 
+// Only metadata stays resident; the HTML is rendered on request and kept in
+// the LessonCache.
 struct Lesson {
-  int id;
-  String title;
-  String content;
-  bool isValid;
-  Lesson() : id(0), title(""), content(""), isValid(false) {}
+  int32_t id;
+  TextSpan title;
+  TextSpan path;        // Markdown source when loaded from raw files
+  uint32_t size;        // Size and hash of that source, for change detection
+  uint32_t hash;
+  uint32_t bodyOffset;  // Location of the rendered HTML in the content pack
+  uint32_t bodyLength;
+  uint16_t module;
 };
 
+// Only the answer key stays resident; the text is a quizBlockEncode() block,
+// read with ContentParser::readQuestion() when a page shows it.
 struct QuizQuestion {
-  String question;
-  String options[4];
-  int optionCount;
-  char correctAnswer;
-  QuizQuestion() : question(""), optionCount(0), correctAnswer('a') {
-    for(int i=0; i<4; i++) options[i] = "";
-  }
+  const char* block;     // In the arena when loaded from raw files, else null
+  uint32_t blockOffset;  // and the block is at this offset in the content pack
+  uint16_t blockLength;
+  uint8_t optionCount;
+  char correctAnswer;    // 'a' for the first option
+  uint16_t module;
+};
+
+// The text of one question at a time. Pack questions are read from flash
+// into buf, and the pack is kept open from one question to the next.
+struct QuizText {
+  QuizQuestionSpans spans;
+  File pack;
+  char buf[QUIZ_BLOCK_MAX];
+  ~QuizText() { if (pack) pack.close(); }
 };
 
+// Lessons and questions of a module are contiguous in the tables.
 struct Module {
-  String id;
-  String name;
-  Lesson lessons[MAX_LESSONS];
-  int lessonCount;
-  QuizQuestion quizQuestions[MAX_QUIZ_QUESTIONS];
-  int quizQuestionCount;
-  bool hasQuiz;
-  bool isValid;
-  Module() : id(""), name(""), lessonCount(0), quizQuestionCount(0), hasQuiz(false), isValid(false) {}
+  TextSpan id;
+  TextSpan name;
+  uint32_t firstLesson;
+  uint32_t firstQuestion;
+  uint16_t lessonCount;
+  uint16_t quizQuestionCount;
+  int32_t minLessonId;  // Lesson id of slot 0
+  uint32_t firstSlot;   // Into ContentSet::lessonSlots; slotCount 0 = ids too sparse
+  uint32_t slotCount;
+  TextSpan quizPath;    // Quiz source when loaded from raw files
+  uint32_t quizSize;
+  uint32_t quizHash;
+  bool hasQuiz() const { return quizQuestionCount > 0; }
+};
+
+struct ReloadStats {
+  uint32_t files;     // Lesson and quiz files seen
+  uint32_t reparsed;  // Files read and parsed again (added or changed)
+  uint32_t added;
+  uint32_t changed;
+  uint32_t removed;
+  uint32_t millis;
+  bool full;          // Loaded from a valid content pack, as a whole
+};
+
+#define LESSON_SLOT_EMPTY 0xFFFF
+#define MODULE_INDEX_EMPTY 0xFFFFFFFF
+
+// Everything one load produced. The arena owns the tables and every piece of
+// text the entries point to, so a whole generation is freed in one step.
+struct ContentSet {
+  Arena arena;
+  Module* modules;
+  Lesson* lessons;
+  QuizQuestion* questions;
+  uint32_t moduleCount;
+  uint32_t lessonCount;
+  uint32_t questionCount;
+  // Open-addressed hash of module id -> module index, moduleIndexMask + 1 entries
+  uint32_t* moduleIndex;
+  uint32_t moduleIndexMask;
+  // Per module, lesson id - minLessonId -> position within the module
+  uint16_t* lessonSlots;
+  ContentSet() : modules(nullptr), lessons(nullptr), questions(nullptr), moduleCount(0), lessonCount(0), questionCount(0),
+                 moduleIndex(nullptr), moduleIndexMask(0), lessonSlots(nullptr) {}
 };
 
 class ContentParser {
 private:
-  Module modules[MAX_MODULES];
-  int moduleCount;
+  ContentSet* content;  // Generation being served, never null
+  ContentSet* building; // Generation being loaded
+  // Tables grow here while loading, then move into building->arena
+  FlatTable<Module> newModules;
+  FlatTable<Lesson> newLessons;
+  FlatTable<QuizQuestion> newQuestions;
+  LessonCache lessonCache;
+  IngestBuffer ingest;  // Scratch for whole-file reads, reused across files
+  bool manifestStale;   // A file no longer matches the manifest
+  BootProfile profile;  // Filled by initialize() and the first loadModules()
+  uint32_t generation;  // Bumped whenever a new generation is swapped in
+
+  static uint32_t profileClock() { return (uint32_t)micros(); }
+  static uint32_t profileHeap() { return ESP.getFreeHeap(); }
+
+  // md_html() output goes to the client and, while it still fits the cache
+  // budget, into a copy that is cached once rendering completes.
+  struct RenderTee {
+    ChunkedWriter* out;
+    String copy;
+    size_t limit;
+    bool keep;
+  };
 
-  static void mdProcessOutput(const MD_CHAR* text, MD_SIZE size, void* userdata) {
-    String* output = (String*)userdata;
-    for (MD_SIZE i = 0; i < size; i++) *output += text[i];
+  static void mdTeeOutput(const MD_CHAR* text, MD_SIZE size, void* userdata) {
+    RenderTee* tee = (RenderTee*)userdata;
+    tee->out->write(text, size);
+    if (!tee->keep) return;
+    if (tee->copy.length() + size > tee->limit) { tee->keep = false; tee->copy = String(); return; }
+    tee->copy.concat(text, size);
   }
 
-  String markdownToHtml(const String& markdown) {
-    String htmlOutput = "";
-    md_html(markdown.c_str(), markdown.length(), mdProcessOutput, &htmlOutput, 0, 0);
-    return htmlOutput;
+  void streamPackBody(const Lesson& lesson, ChunkedWriter& out) {
+    File file = SPIFFS.open(CONTENT_PACK_PATH, "r");
+    if (!file || !file.seek(lesson.bodyOffset)) return;
+    char buf[256];
+    size_t remaining = lesson.bodyLength;
+    while (remaining > 0) {
+      size_t n = file.read((uint8_t*)buf, remaining < sizeof(buf) ? remaining : sizeof(buf));
+      if (n == 0) break;
+      out.write(buf, n);
+      remaining -= n;
+    }
+    file.close();
   }
 
-  String toTitleCase(const String& input) {
-    String result = "";
-    bool capitalizeNext = true;
-    for (unsigned int i = 0; i < input.length(); i++) {
-      char c = input.charAt(i);
-      if (c == '-' || c == '_') { result += ' '; capitalizeNext = true; }
-      else if (capitalizeNext) { result += (char)toupper(c); capitalizeNext = false; }
-      else { result += (char)tolower(c); }
+  // Renders a Markdown lesson into out; returns the HTML if it fits the cache.
+  String renderLessonFile(const Lesson& lesson, ChunkedWriter& out) {
+    char path[64];
+    if (lesson.path.len + 1 > sizeof(path)) return "";
+    memcpy(path, lesson.path.ptr, lesson.path.len);
+    path[lesson.path.len] = '\0';
+
+    File file = SPIFFS.open(path, "r");
+    if (!file) { manifestStale = true; return ""; }
+    TextSpan markdown;
+    bool ok = ingest.load(file, markdown);
+    file.close();
+    if (!ok) return "";
+    if (!manifestStale && (markdown.len != lesson.size || contentHash(markdown.ptr, markdown.len) != lesson.hash)) {
+      Serial.println("Content changed since the manifest was written; it will be rebuilt on the next load.");
+      manifestStale = true;
     }
-    return result;
+
+    RenderTee tee;
+    tee.out = &out;
+    tee.limit = lessonCache.getBudget();
+    tee.keep = true;
+    md_html(markdown.ptr, markdown.len, mdTeeOutput, &tee, 0, 0);
+    return tee.keep ? tee.copy : String();
   }
 
-  // Extracts ID from "1.intro.content" (returns 1)
-  int extractLessonId(const String& filename) {
-    int endIdx = filename.indexOf('.');
-    if (endIdx > 0 && isDigit(filename.charAt(0))) {
-      return filename.substring(0, endIdx).toInt();
+  static TextSpan toSpan(const String& s) { return TextSpan(s.c_str(), s.length()); }
+
+  static bool sameText(TextSpan a, TextSpan b) { return a.len == b.len && memcmp(a.ptr, b.ptr, a.len) == 0; }
+
+  TextSpan addText(TextSpan s) { return building->arena.copy(s); }
+
+  // Index of the module with this id, created if needed; -1 when out of memory.
+  int moduleIndexFor(TextSpan id) {
+    for (uint32_t i = 0; i < newModules.size(); i++) {
+      if (sameText(newModules[i].id, id)) return (int)i;
     }
-    return 0; 
-  }
-
-  String extractTitle(const String& markdown) {
-    int startIdx = markdown.indexOf("# ");
-    if (startIdx == -1) return "Untitled";
-    startIdx += 2;
-    int endIdx = markdown.indexOf("\n", startIdx);
-    if (endIdx == -1) endIdx = markdown.length();
-    return markdown.substring(startIdx, endIdx);
-  }
-
-  void parseQuizFile(const String& quizContent, Module& module) {
-    int questionCount = 0;
-    int pos = 0;
-    while (pos < quizContent.length() && questionCount < MAX_QUIZ_QUESTIONS) {
-      int qStart = quizContent.indexOf("###", pos);
-      if (qStart == -1) break;
-      int qEnd = quizContent.indexOf("\n", qStart);
-      if (qEnd == -1) break;
-      
-      int nextLine = qEnd + 1;
-      int qTextEnd = quizContent.indexOf("\n\n", nextLine);
-      if (qTextEnd == -1) qTextEnd = quizContent.indexOf("\na)", nextLine);
-      
-      if (qTextEnd > nextLine) {
-        String qText = quizContent.substring(nextLine, qTextEnd);
-        qText.trim();
-        if (qText.length() > 0 && !qText.startsWith("**")) {
-          module.quizQuestions[questionCount].question = qText;
-          int optCount = 0;
-          for (char opt = 'a'; opt <= 'd'; opt++) {
-            String pattern = String(opt) + ")";
-            int optStart = quizContent.indexOf(pattern, qTextEnd);
-            if (optStart == -1 || optStart > qTextEnd + 500) break;
-            int optEnd = quizContent.indexOf("\n", optStart);
-            if (optEnd == -1) optEnd = quizContent.length();
-            String optStr = quizContent.substring(optStart + 2, optEnd);
-            optStr.trim();
-            module.quizQuestions[questionCount].options[optCount++] = optStr;
-          }
-          module.quizQuestions[questionCount].optionCount = optCount;
-          
-          int ansPos = quizContent.indexOf("**Answer:", qTextEnd);
-          if (ansPos == -1) ansPos = quizContent.indexOf("**Sagot:", qTextEnd);
-          if (ansPos != -1 && ansPos < qTextEnd + 500) {
-             int ansStart = quizContent.indexOf(")", ansPos) - 1;
-             if (ansStart > ansPos) module.quizQuestions[questionCount].correctAnswer = quizContent.charAt(ansStart);
-          }
-          questionCount++;
-        }
+    if (newModules.size() >= 0xFFFF) return -1;
+    Module* m = newModules.add();
+    if (!m) return -1;
+    char name[64];
+    m->id = addText(id);
+    m->name = addText(TextSpan(name, moduleNameInto(id, name, sizeof(name))));
+    Serial.println("Created Module: " + str(m->name));
+    return (int)(newModules.size() - 1);
+  }
+
+  static void printQuizError(uint32_t line, const char* message, void* ctx) {
+    Serial.printf("Quiz %s line %u: %s\n", (const char*)ctx, (unsigned)line, message);
+  }
+
+  // path is only for error messages. Returns false when out of memory, with
+  // none of the file's questions added.
+  bool parseQuizFile(TextSpan quizContent, uint16_t moduleIndex, TextSpan path) {
+    char name[64];
+    size_t n = path.len < sizeof(name) - 1 ? path.len : sizeof(name) - 1;
+    memcpy(name, path.ptr, n);
+    name[n] = '\0';
+    QuizReader reader(quizContent.ptr, quizContent.len, printQuizError, name);
+    QuizQuestionSpans q;
+    char block[QUIZ_BLOCK_MAX];
+    uint32_t first = newQuestions.size();
+    while (reader.next(q)) {
+      size_t len = quizBlockEncode(q, block, sizeof(block));
+      if (len == 0) { Serial.printf("Quiz %s: question over %u bytes left out\n", name, (unsigned)QUIZ_BLOCK_MAX); continue; }
+      TextSpan copy = addText(TextSpan(block, len));
+      QuizQuestion* target = copy.len == len ? newQuestions.add() : nullptr;
+      if (!target) {
+        newQuestions.truncate(first);
+        return false;
       }
-      pos = qEnd + 1;
+      target->block = copy.ptr;
+      target->blockOffset = 0;
+      target->blockLength = (uint16_t)len;
+      target->optionCount = (uint8_t)q.optionCount;
+      target->correctAnswer = q.correctAnswer;
+      target->module = moduleIndex;
     }
-    module.quizQuestionCount = questionCount;
-    module.hasQuiz = (questionCount > 0);
+    return true;
   }
 
-public:
-  ContentParser() : moduleCount(0) {}
+  // Stable counting sort by T::module, so each module's entries are
+  // contiguous; first[m] receives where module m starts (first[moduleCount]
+  // is the total). O(entries + modules).
+  template <typename T>
+  static bool groupByModule(FlatTable<T>& table, uint32_t moduleCount, uint32_t* first) {
+    memset(first, 0, (moduleCount + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < table.size(); i++) first[table[i].module + 1]++;
+    for (uint32_t m = 0; m < moduleCount; m++) first[m + 1] += first[m];
+    T* sorted = (T*)malloc(table.size() * sizeof(T) + 1);
+    uint32_t* next = (uint32_t*)malloc(moduleCount * sizeof(uint32_t) + 1);
+    if (!sorted || !next) { free(sorted); free(next); return false; }
+    memcpy(next, first, moduleCount * sizeof(uint32_t));
+    for (uint32_t i = 0; i < table.size(); i++) sorted[next[table[i].module]++] = table[i];
+    memcpy((void*)table.data(), sorted, table.size() * sizeof(T));
+    free(sorted);
+    free(next);
+    return true;
+  }
 
-  bool initialize() {
-    if (!SPIFFS.begin(true)) return false;
-    Serial.println("SPIFFS mounted.");
+  // Makes each module's lessons (ordered by id) and questions contiguous,
+  // then moves the tables into the arena at their final size.
+  bool finishLoad() {
+    uint32_t count = newModules.size();
+    uint32_t* first = (uint32_t*)malloc((count + 1) * sizeof(uint32_t));
+    if (!first || !groupByModule(newLessons, count, first)) { free(first); return false; }
+    for (uint32_t m = 0; m < count; m++) {
+      newModules[m].firstLesson = first[m];
+      newModules[m].lessonCount = (uint16_t)(first[m + 1] - first[m]);
+      // Lessons per module are few; insertion sort by id keeps file order for ties
+      for (uint32_t i = first[m] + 1; i < first[m + 1]; i++) {
+        Lesson moved = newLessons[i];
+        uint32_t j = i;
+        while (j > first[m] && newLessons[j - 1].id > moved.id) { newLessons[j] = newLessons[j - 1]; j--; }
+        newLessons[j] = moved;
+      }
+    }
+    if (!groupByModule(newQuestions, count, first)) { free(first); return false; }
+    for (uint32_t m = 0; m < count; m++) {
+      newModules[m].firstQuestion = first[m];
+      newModules[m].quizQuestionCount = (uint16_t)(first[m + 1] - first[m]);
+    }
+    free(first);
+    uint32_t slotTotal = 0;
+    for (uint32_t m = 0; m < count; m++) slotTotal += planLessonSlots(newModules[m]);
+
+    ContentSet& set = *building;
+    set.moduleCount = newModules.size();
+    set.lessonCount = newLessons.size();
+    set.questionCount = newQuestions.size();
+    set.modules = set.arena.copyArray(newModules.data(), set.moduleCount);
+    set.lessons = set.arena.copyArray(newLessons.data(), set.lessonCount);
+    set.questions = set.arena.copyArray(newQuestions.data(), set.questionCount);
+    newModules.clear();
+    newLessons.clear();
+    newQuestions.clear();
+    if ((set.moduleCount && !set.modules) || (set.lessonCount && !set.lessons) || (set.questionCount && !set.questions)) return false;
+    if (!buildIndexes(set, slotTotal)) return false;
+    Serial.printf("Content model: %u bytes in %u arena blocks (%u modules, %u lessons, %u questions)\n",
+                  (unsigned)set.arena.bytesReserved(), (unsigned)set.arena.blockCount(),
+                  (unsigned)set.moduleCount, (unsigned)set.lessonCount, (unsigned)set.questionCount);
     return true;
   }
 
-  // ⭐️ LOGIC CHANGE: Group by Filename Prefix
-  void loadModules() {
+  // Chooses the id range covered by a module's slot map. Lessons are already
+  // sorted by id. Ids spread much wider than the lesson count get no slot map
+  // and are found by binary search instead.
+  uint32_t planLessonSlots(Module& m) {
+    m.slotCount = 0;
+    if (m.lessonCount == 0) return 0;
+    int32_t lo = newLessons[m.firstLesson].id;
+    int32_t hi = newLessons[m.firstLesson + m.lessonCount - 1].id;
+    uint32_t span = (uint32_t)(hi - lo) + 1;
+    if (span > 4u * m.lessonCount + 16) return 0;
+    m.minLessonId = lo;
+    m.slotCount = span;
+    return span;
+  }
+
+  static uint32_t moduleHash(TextSpan id) { return contentHash(id.ptr, id.len); }
+
+  // Builds the module id hash and the lesson slot maps in the generation's
+  // arena, so route lookups cost one probe instead of a scan.
+  bool buildIndexes(ContentSet& set, uint32_t slotTotal) {
+    uint32_t size = 8;
+    while (size < set.moduleCount * 2) size *= 2;
+    set.moduleIndex = (uint32_t*)set.arena.alloc(size * sizeof(uint32_t));
+    if (!set.moduleIndex) return false;
+    memset(set.moduleIndex, 0xFF, size * sizeof(uint32_t));
+    set.moduleIndexMask = size - 1;
+    for (uint32_t i = 0; i < set.moduleCount; i++) {
+      uint32_t h = moduleHash(set.modules[i].id) & set.moduleIndexMask;
+      bool duplicate = false;
+      while (set.moduleIndex[h] != MODULE_INDEX_EMPTY && !duplicate) {
+        duplicate = sameText(set.modules[set.moduleIndex[h]].id, set.modules[i].id);
+        h = (h + 1) & set.moduleIndexMask;
+      }
+      if (!duplicate) set.moduleIndex[h] = i;  // First module with an id wins, as with a scan
+    }
+
+    if (slotTotal == 0) return true;
+    set.lessonSlots = (uint16_t*)set.arena.alloc(slotTotal * sizeof(uint16_t), alignof(uint16_t));
+    if (!set.lessonSlots) return false;
+    memset(set.lessonSlots, 0xFF, slotTotal * sizeof(uint16_t));
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < set.moduleCount; i++) {
+      Module& m = set.modules[i];
+      m.firstSlot = next;
+      next += m.slotCount;
+      if (m.slotCount == 0) continue;
+      // Walk backwards so the first of several lessons with one id wins
+      for (int j = m.lessonCount - 1; j >= 0; j--) {
+        set.lessonSlots[m.firstSlot + (set.lessons[m.firstLesson + j].id - m.minLessonId)] = (uint16_t)j;
+      }
+    }
+    return true;
+  }
+
+  // Boots from the pre-rendered /content.pack: reads only the index, lesson
+  // bodies and quiz text stay in flash until requested. Returns false if there is no valid
+  // pack so the caller can fall back to scanning the raw files.
+  bool loadPack(BootRecord& phase) {
+    File file = SPIFFS.open(CONTENT_PACK_PATH, "r");
+    if (!file) return false;
+
+    PackHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != CONTENT_PACK_MAGIC || header.version != CONTENT_PACK_VERSION ||
+        header.indexSize < sizeof(header) || header.indexSize > file.size()) {
+      Serial.println("Ignoring invalid content pack.");
+      file.close();
+      return false;
+    }
+
+    uint8_t* index = (uint8_t*)malloc(header.indexSize);
+    if (!index) { file.close(); return false; }
+    memcpy(index, &header, sizeof(header));
+    size_t got = file.read(index + sizeof(header), header.indexSize - sizeof(header));
+    phase.bytesRead += sizeof(header) + got;
+    size_t fileSize = file.size();
+    file.close();
+    if (got != header.indexSize - sizeof(header) || !packIndexValid(index, header.indexSize, fileSize)) {
+      Serial.println("Ignoring invalid content pack.");
+      free(index);
+      return false;
+    }
+
+    const PackModule* packModules = (const PackModule*)(index + packModulesOffset(header));
+    const PackLesson* packLessons = (const PackLesson*)(index + packLessonsOffset(header));
+    const PackQuestion* packQuestions = (const PackQuestion*)(index + packQuestionsOffset(header));
+    // The pack's string pool is copied into the arena in one piece
+    const char* strings = (const char*)building->arena.copy(
+        TextSpan((const char*)(index + packStringsOffset(header)), header.stringPoolSize)).ptr;
+    bool ok = (strings || header.stringPoolSize == 0) &&
+              newModules.add(header.moduleCount) && newLessons.add(header.lessonCount) &&
+              newQuestions.add(header.questionCount);
+    if (!ok && (header.moduleCount || header.lessonCount || header.questionCount)) {
+      Serial.println("Out of memory loading content pack.");
+      free(index);
+      return false;
+    }
+    auto view = [strings](const PackStr& s) { return TextSpan(strings + s.offset, s.length); };
+
+    for (unsigned i = 0; i < header.moduleCount; i++) {
+      const PackModule& pm = packModules[i];
+      Module& m = newModules[i];
+      m.id = view(pm.id);
+      m.name = view(pm.name);
+      m.quizHash = pm.quizHash;
+      for (unsigned j = 0; j < pm.lessonCount; j++) {
+        const PackLesson& pl = packLessons[pm.firstLesson + j];
+        Lesson& l = newLessons[pm.firstLesson + j];
+        l.id = pl.id;
+        l.title = view(pl.title);
+        l.bodyOffset = pl.bodyOffset;
+        l.bodyLength = pl.bodyLength;
+        l.hash = pl.hash;
+        l.module = (uint16_t)i;
+      }
+      for (unsigned j = 0; j < pm.questionCount; j++) {
+        const PackQuestion& pq = packQuestions[pm.firstQuestion + j];
+        QuizQuestion& q = newQuestions[pm.firstQuestion + j];
+        q.block = nullptr;
+        q.blockOffset = pq.blockOffset;
+        q.blockLength = pq.blockLength;
+        q.optionCount = pq.optionCount;
+        q.correctAnswer = (char)('a' + pq.answer);
+        q.module = (uint16_t)i;
+      }
+      Serial.println("Loaded Module from pack: " + str(m.name) + " (Lessons: " + String(pm.lessonCount) + ")");
+    }
+    free(index);
+    return true;
+  }
+
+  // Adds one lesson or quiz file ("math_1.intro.content") to the generation
+  // being built. Returns false when out of memory.
+  bool addFile(TextSpan fullName, TextSpan content) {
+    // Split the prefix (e.g., "math_1.intro.content" -> "math", "1.intro.content")
+    TextSpan moduleID, realFileName;
+    splitModulePrefix(fullName, moduleID, realFileName);
+
+    // Find or Create Module
+    int modIdx = moduleIndexFor(moduleID);
+    if (modIdx < 0) return false;
+
+    char path[64];
+    path[0] = '/';
+    size_t n = fullName.len < sizeof(path) - 1 ? fullName.len : sizeof(path) - 1;
+    memcpy(path + 1, fullName.ptr, n);
+    TextSpan pathText = addText(TextSpan(path, n + 1));
+    if (pathText.len != n + 1) return false;
+
+    if (contentKindOf(realFileName) == CONTENT_LESSON) {
+      Lesson* l = newLessons.add();
+      if (!l) return false;
+      l->id = lessonIdFromName(realFileName); // logic works on "1.intro.content"
+      l->title = addText(lessonTitleOf(content));
+      l->path = pathText;
+      l->size = content.len;
+      l->hash = contentHash(content.ptr, content.len);
+      l->module = (uint16_t)modIdx;
+      Serial.println("  Added Lesson to " + str(newModules[modIdx].id) + ": " + str(l->title));
+    } else {
+      if (!parseQuizFile(content, (uint16_t)modIdx, pathText)) return false;
+      Module& m = newModules[modIdx];
+      m.quizPath = pathText;
+      m.quizSize = content.len;
+      m.quizHash = contentHash(content.ptr, content.len);
+      Serial.println("  Added Quiz to " + str(m.id));
+    }
+    return true;
+  }
+
+  void scanFiles(BootRecord& phase) {
     File root = SPIFFS.open("/");
     if (!root) return;
 
-    moduleCount = 0;
     Serial.println("Scanning files using Prefix Grouping...");
 
     while (true) {
@@ -156,106 +487,469 @@ public:
       String fullName = String(file.name());
       if (fullName.startsWith("/")) fullName = fullName.substring(1); // Remove leading slash
 
-      // Skip system files
-      if (fullName.startsWith(".") || file.isDirectory()) {
+      // Skip system files and anything that is neither a lesson nor a quiz
+      if (fullName.startsWith(".") || file.isDirectory() || contentKindOf(toSpan(fullName)) == CONTENT_NONE) {
         file.close();
         continue;
       }
 
-      String moduleID = "general";     // Default bucket
-      String realFileName = fullName;  // Default filename
+      // --- Parse File into the Module ---
+      BootRecord& record = profile.beginFile(fullName.c_str(), fullName.length());
+      TextSpan content;
+      if (!ingest.load(file, content)) {
+        Serial.println("Read failed. Skipping: " + fullName);
+      } else if (!addFile(toSpan(fullName), content)) {
+        Serial.println("Out of memory. Skipping: " + fullName);
+      }
+      record.bytesRead = content.len;
+      phase.bytesRead += content.len;
+      profile.end(record);
+      file.close();
+    }
+    root.close();
+  }
+
+  // Splits the next tab-separated field off line.
+  static TextSpan nextField(TextSpan& line) {
+    const char* tab = (const char*)memchr(line.ptr, '\t', line.len);
+    size_t n = tab ? (size_t)(tab - line.ptr) : line.len;
+    TextSpan field(line.ptr, n);
+    line = tab ? TextSpan(tab + 1, line.len - n - 1) : TextSpan(line.ptr + n, 0);
+    return field;
+  }
+
+  // Splits the next line, without its line break, off text.
+  static TextSpan nextLine(TextSpan& text) {
+    const char* nl = (const char*)memchr(text.ptr, '\n', text.len);
+    size_t n = nl ? (size_t)(nl - text.ptr) : text.len;
+    TextSpan line(text.ptr, n);
+    text = nl ? TextSpan(nl + 1, text.len - n - 1) : TextSpan(text.ptr + n, 0);
+    if (line.len > 0 && line.ptr[line.len - 1] == '\r') line.len--;
+    return line;
+  }
+
+  static uint32_t fieldNumber(TextSpan field, int base) {
+    char digits[16];
+    size_t n = field.len < sizeof(digits) - 1 ? field.len : sizeof(digits) - 1;
+    memcpy(digits, field.ptr, n);
+    digits[n] = '\0';
+    return strtoul(digits, nullptr, base);
+  }
+
+  // Builds the generation from the manifest: one small read and the quiz
+  // files. Lesson files are not opened until they are requested. Returns
+  // false if the manifest is missing, malformed or incomplete, or if a quiz
+  // no longer matches it.
+  bool loadManifest(BootRecord& phase) {
+    File file = SPIFFS.open(CONTENT_MANIFEST_PATH, "r");
+    if (!file) return false;
+    TextSpan text;
+    bool ok = ingest.load(file, text);
+    file.close();
+    phase.bytesRead += text.len;
+    size_t headerLen = strlen(CONTENT_MANIFEST_HEADER);
+    if (!ok || text.len <= headerLen || memcmp(text.ptr, CONTENT_MANIFEST_HEADER, headerLen) != 0 ||
+        text.ptr[headerLen] != '\t') return false;
+
+    // Copied into the arena, since the quiz reads below reuse the ingest buffer
+    TextSpan rest = addText(text);
+    if (rest.len != text.len) return false;
+    TextSpan header = nextLine(rest);
+    header = TextSpan(header.ptr + headerLen + 1, header.len - headerLen - 1);
+    uint32_t files = fieldNumber(nextField(header), 10);
+    Serial.println("Loading content from manifest...");
+
+    uint32_t records = 0;
+    while (rest.len > 0) {
+      TextSpan line = nextLine(rest);
+      TextSpan kind = nextField(line);
+      if (kind.len != 1 || (kind.ptr[0] != 'L' && kind.ptr[0] != 'Q')) continue;
+      int modIdx = moduleIndexFor(nextField(line));
+      if (modIdx < 0) return false;
+      if (kind.ptr[0] == 'L') {
+        Lesson* l = newLessons.add();
+        if (!l) return false;
+        l->id = (int32_t)fieldNumber(nextField(line), 10);
+        l->title = nextField(line);
+        l->path = nextField(line);
+        l->size = fieldNumber(nextField(line), 10);
+        l->hash = fieldNumber(nextField(line), 16);
+        l->module = (uint16_t)modIdx;
+      } else {
+        Module& m = newModules[modIdx];
+        m.quizPath = nextField(line);
+        m.quizSize = fieldNumber(nextField(line), 10);
+        m.quizHash = fieldNumber(nextField(line), 16);
+      }
+      records++;
+    }
+    if (records != files) {
+      Serial.println("Manifest is incomplete: " + String(records) + " of " + String(files) + " files.");
+      return false;
+    }
+
+    // Quizzes are parsed now; a changed one means the manifest is stale
+    for (uint32_t i = 0; i < newModules.size(); i++) {
+      Module& m = newModules[i];
+      if (m.quizPath.len == 0) continue;
+      char path[64];
+      if (m.quizPath.len + 1 > sizeof(path)) return false;
+      memcpy(path, m.quizPath.ptr, m.quizPath.len);
+      path[m.quizPath.len] = '\0';
+      BootRecord& record = profile.beginFile(path + 1, m.quizPath.len - 1);
+      File quiz = SPIFFS.open(path, "r");
+      TextSpan content;
+      bool read = quiz && ingest.load(quiz, content);
+      if (quiz) quiz.close();
+      record.bytesRead = content.len;
+      phase.bytesRead += content.len;
+      if (!read || content.len != m.quizSize || contentHash(content.ptr, content.len) != m.quizHash) {
+        profile.end(record);
+        Serial.println("Manifest is stale: " + str(m.quizPath));
+        return false;
+      }
+      bool parsed = parseQuizFile(content, (uint16_t)i, m.quizPath);
+      profile.end(record);
+      if (!parsed) {
+        Serial.println("Out of memory loading " + str(m.quizPath));
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static void writeField(File& out, TextSpan s) {
+    for (size_t i = 0; i < s.len; i++) out.write((uint8_t)(s.ptr[i] == '\t' || s.ptr[i] == '\n' ? ' ' : s.ptr[i]));
+  }
 
-      // Check for Prefix (e.g., "math_1.intro.content")
-      int underscoreIndex = fullName.indexOf('_');
-      if (underscoreIndex > 0) {
-        moduleID = fullName.substring(0, underscoreIndex); // "math"
-        realFileName = fullName.substring(underscoreIndex + 1); // "1.intro.content"
+  // Rewrites the manifest from the current generation after a full scan.
+  void writeManifest() {
+    File out = SPIFFS.open(CONTENT_MANIFEST_PATH, "w");
+    if (!out) { Serial.println("Could not write manifest."); return; }
+    uint32_t files = 0;
+    for (uint32_t i = 0; i < content->lessonCount; i++) if (content->lessons[i].path.len) files++;
+    for (uint32_t i = 0; i < content->moduleCount; i++) if (content->modules[i].quizPath.len) files++;
+    out.printf(CONTENT_MANIFEST_HEADER "\t%u\n", (unsigned)files);
+    for (uint32_t i = 0; i < content->moduleCount; i++) {
+      const Module& m = content->modules[i];
+      for (uint32_t j = 0; j < m.lessonCount; j++) {
+        const Lesson& l = content->lessons[m.firstLesson + j];
+        out.print("L\t"); writeField(out, m.id);
+        out.printf("\t%d\t", (int)l.id); writeField(out, l.title);
+        out.print("\t"); writeField(out, l.path);
+        out.printf("\t%u\t%08x\n", (unsigned)l.size, (unsigned)l.hash);
       }
+      if (m.quizPath.len > 0) {
+        out.print("Q\t"); writeField(out, m.id);
+        out.print("\t"); writeField(out, m.quizPath);
+        out.printf("\t%u\t%08x\n", (unsigned)m.quizSize, (unsigned)m.quizHash);
+      }
+    }
+    out.close();
+    manifestStale = false;
+    Serial.println("Manifest written.");
+  }
+
+  // Carries an unchanged lesson over from the previous generation.
+  bool copyLesson(const ContentSet& prev, const Lesson& old) {
+    int modIdx = moduleIndexFor(prev.modules[old.module].id);
+    if (modIdx < 0) return false;
+    Lesson* l = newLessons.add();
+    if (!l) return false;
+    *l = old;
+    l->title = addText(old.title);
+    l->path = addText(old.path);
+    l->module = (uint16_t)modIdx;
+    return l->path.len == old.path.len;
+  }
 
-      // Find or Create Module
-      int modIdx = -1;
-      for (int i = 0; i < moduleCount; i++) {
-        if (modules[i].id == moduleID) {
-          modIdx = i;
-          break;
-        }
+  // Carries an unchanged quiz over from the previous generation.
+  bool copyQuiz(const ContentSet& prev, const Module& old) {
+    int modIdx = moduleIndexFor(old.id);
+    if (modIdx < 0) return false;
+    for (uint32_t i = 0; i < old.quizQuestionCount; i++) {
+      const QuizQuestion& src = prev.questions[old.firstQuestion + i];
+      QuizQuestion* q = newQuestions.add();
+      if (!q) return false;
+      *q = src;
+      if (src.block) {
+        TextSpan copy = addText(TextSpan(src.block, src.blockLength));
+        if (copy.len != src.blockLength) return false;
+        q->block = copy.ptr;
       }
+      q->module = (uint16_t)modIdx;
+    }
+    Module& m = newModules[modIdx];
+    m.quizPath = addText(old.quizPath);
+    m.quizSize = old.quizSize;
+    m.quizHash = old.quizHash;
+    return m.quizPath.len == old.quizPath.len;
+  }
+
+  // Finishes the generation in building and swaps it in, freeing the old one.
+  // On failure the current content stays.
+  bool commitBuild() {
+    bool ok = finishLoad();
+    newModules.clear();
+    newLessons.clear();
+    newQuestions.clear();
+    if (ok) {
+      ContentSet* old = content;
+      content = building;
+      delete old;
+      generation++;
+    } else {
+      Serial.println("Out of memory loading content. Keeping previous content.");
+      delete building;
+    }
+    building = nullptr;
+    return ok;
+  }
+
+  void resetBuild() {
+    newModules.clear();
+    newLessons.clear();
+    newQuestions.clear();
+    building->arena.reset();
+  }
+
+  static void printHeap(const char* label) {
+    uint32_t freeBytes = ESP.getFreeHeap();
+    uint32_t largest = ESP.getMaxAllocHeap();
+    Serial.printf("Heap %s: free %u, largest block %u (fragmentation %u%%)\n", label, (unsigned)freeBytes,
+                  (unsigned)largest, freeBytes ? (unsigned)(100 - (uint64_t)largest * 100 / freeBytes) : 0u);
+  }
+
+public:
+  ContentParser() : content(new ContentSet()), building(nullptr), manifestStale(false), profile(profileClock, profileHeap),
+                    generation(0) {}
+
+  bool initialize() {
+    BootRecord& phase = profile.beginPhase("mount");
+    bool mounted = SPIFFS.begin(true);
+    profile.end(phase);
+    if (!mounted) return false;
+    Serial.println("SPIFFS mounted.");
+    return true;
+  }
+
+  // ⭐️ LOGIC CHANGE: Group by Filename Prefix
+  // Loads a new generation next to the current one and swaps it in; the old
+  // generation is freed in one step. On failure the current content stays.
+  void loadModules() {
+    printHeap("before load");
+    building = new (std::nothrow) ContentSet();
+    if (!building) { Serial.println("Out of memory loading content. Keeping previous content."); return; }
+    bool scanned = false;
+    BootRecord* phase = &profile.beginPhase("pack");
+    bool loaded = loadPack(*phase);
+    if (!loaded) {
+      resetBuild();
+      profile.end(*phase);
+      phase = &profile.beginPhase("manifest");
+      loaded = !manifestStale && loadManifest(*phase);
+    }
+    if (!loaded) {
+      resetBuild();
+      profile.end(*phase);
+      phase = &profile.beginPhase("scan");
+      scanFiles(*phase);
+      scanned = true;
+    }
+    profile.end(*phase);
+
+    phase = &profile.beginPhase("index");
+    bool ok = commitBuild();
+    profile.end(*phase);
+    if (ok) lessonCache.clear();
+    if (ok && scanned) {
+      phase = &profile.beginPhase("write manifest");
+      writeManifest();
+      profile.end(*phase);
+    }
+    Serial.print("Total modules loaded: "); Serial.println(getModuleCount());
+    printHeap("after load");
+    if (!profile.isFinished()) {
+      profile.printTable(Serial);
+      profile.finish();
+    }
+  }
+
+  // Re-reads only what changed since the last load: files whose size or hash
+  // differ, new files and removed files. Unchanged lessons and quizzes are
+  // carried over without parsing. The new generation replaces the old one in
+  // a single pointer swap, so a request never sees a half-loaded module.
+  ReloadStats reloadModules() {
+    ReloadStats stats;
+    memset(&stats, 0, sizeof(stats));
+    unsigned long start = millis();
+    building = new (std::nothrow) ContentSet();
+    if (!building) { Serial.println("Out of memory reloading content."); return stats; }
+
+    // A valid pack is one prebuilt file; its index is as cheap as it gets.
+    // A missing, damaged or outdated one falls through to the file scan
+    BootRecord& phase = profile.beginPhase("reload pack");
+    bool packed = loadPack(phase);
+    profile.end(phase);
+    if (packed) {
+      stats.full = commitBuild();
+      if (stats.full) lessonCache.clear();
+      stats.files = content->lessonCount;
+      for (uint32_t i = 0; i < content->moduleCount; i++) stats.files += content->modules[i].hasQuiz();
+      stats.millis = millis() - start;
+      return stats;
+    }
+    resetBuild();
+    const ContentSet& prev = *content;
+    uint32_t prevFiles = 0, matched = 0;
+    for (uint32_t i = 0; i < prev.lessonCount; i++) if (prev.lessons[i].path.len) prevFiles++;
+    for (uint32_t i = 0; i < prev.moduleCount; i++) if (prev.modules[i].quizPath.len) prevFiles++;
 
-      // Create new module if not found
-      if (modIdx == -1) {
-        if (moduleCount < MAX_MODULES) {
-          modIdx = moduleCount++;
-          modules[modIdx].id = moduleID;
-          modules[modIdx].name = toTitleCase(moduleID);
-          modules[modIdx].isValid = true;
-          Serial.println("Created Module: " + modules[modIdx].name);
-        } else {
-          Serial.println("Max modules reached. Skipping: " + fullName);
-          file.close();
-          continue;
-        }
+    File root = SPIFFS.open("/");
+    while (root) {
+      File file = root.openNextFile();
+      if (!file) break;
+      String fullName = String(file.name());
+      if (fullName.startsWith("/")) fullName = fullName.substring(1);
+      if (fullName.startsWith(".") || file.isDirectory() || contentKindOf(toSpan(fullName)) == CONTENT_NONE) {
+        file.close();
+        continue;
       }
+      stats.files++;
+      String path = "/" + fullName;
 
-      // --- Parse File into the Module ---
-      // Read content
-      String content = "";
-      while(file.available()) content += (char)file.read();
-      
-      Module& targetMod = modules[modIdx];
-
-      if (realFileName.endsWith(".content") || realFileName.endsWith(".md")) {
-         if (targetMod.lessonCount < MAX_LESSONS) {
-            Lesson& l = targetMod.lessons[targetMod.lessonCount];
-            l.id = extractLessonId(realFileName); // logic works on "1.intro.content"
-            l.title = extractTitle(content);
-            l.content = markdownToHtml(content);
-            l.isValid = true;
-            targetMod.lessonCount++;
-            Serial.println("  Added Lesson to " + moduleID + ": " + l.title);
-         }
-      } 
-      else if (realFileName.endsWith(".quiz") || realFileName.endsWith(".txt")) {
-         parseQuizFile(content, targetMod);
-         Serial.println("  Added Quiz to " + moduleID);
+      const Lesson* oldLesson = nullptr;
+      const Module* oldQuiz = nullptr;
+      for (uint32_t i = 0; i < prev.lessonCount && !oldLesson; i++) {
+        if (sameText(prev.lessons[i].path, toSpan(path))) oldLesson = &prev.lessons[i];
       }
+      for (uint32_t i = 0; i < prev.moduleCount && !oldLesson && !oldQuiz; i++) {
+        if (sameText(prev.modules[i].quizPath, toSpan(path))) oldQuiz = &prev.modules[i];
+      }
+      uint32_t oldSize = oldLesson ? oldLesson->size : oldQuiz ? oldQuiz->quizSize : 0;
+      uint32_t oldHash = oldLesson ? oldLesson->hash : oldQuiz ? oldQuiz->quizHash : 0;
+      if (oldLesson || oldQuiz) matched++;
 
+      TextSpan data;
+      bool loaded = false, same = false;
+      if ((oldLesson || oldQuiz) && file.size() == oldSize) {
+        loaded = ingest.load(file, data);
+        same = loaded && contentHash(data.ptr, data.len) == oldHash;
+      }
+      bool ok;
+      if (same) {
+        ok = oldLesson ? copyLesson(prev, *oldLesson) : copyQuiz(prev, *oldQuiz);
+      } else {
+        ok = (loaded || ingest.load(file, data)) && addFile(toSpan(fullName), data);
+        stats.reparsed++;
+        if (oldLesson || oldQuiz) stats.changed++; else stats.added++;
+      }
       file.close();
+      if (!ok) {
+        Serial.println("Reload failed at " + fullName + ". Keeping previous content.");
+        root.close();
+        resetBuild();
+        delete building;
+        building = nullptr;
+        return stats;
+      }
     }
-    root.close();
-    Serial.print("Total modules loaded: "); Serial.println(moduleCount);
+    if (root) root.close();
+    stats.removed = prevFiles - matched;
+
+    bool changed = stats.reparsed > 0 || stats.removed > 0;
+    if (commitBuild() && (changed || manifestStale)) writeManifest();
+    stats.millis = millis() - start;
+    Serial.printf("Reload: %u files, %u reparsed (%u added, %u changed, %u removed) in %u ms\n",
+                  (unsigned)stats.files, (unsigned)stats.reparsed, (unsigned)stats.added,
+                  (unsigned)stats.changed, (unsigned)stats.removed, (unsigned)stats.millis);
+    return stats;
   }
 
   // Helpers
-  int getModuleCount() const { return moduleCount; }
-  Module* getModule(int i) { return (i >= 0 && i < moduleCount) ? &modules[i] : nullptr; }
-  Module* getModuleById(const String& id) {
-    for (int i=0; i<moduleCount; i++) if (modules[i].id == id) return &modules[i];
+  int getModuleCount() const { return (int)content->moduleCount; }
+  const Module* getModule(int i) const { return (i >= 0 && i < getModuleCount()) ? &content->modules[i] : nullptr; }
+  const Module* getModuleById(const String& id) const { return getModuleById(toSpan(id)); }
+  const Module* getModuleById(TextSpan key) const {
+    const ContentSet& set = *content;
+    if (!set.moduleIndex) return nullptr;
+    for (uint32_t h = moduleHash(key) & set.moduleIndexMask; set.moduleIndex[h] != MODULE_INDEX_EMPTY; h = (h + 1) & set.moduleIndexMask) {
+      const Module& m = set.modules[set.moduleIndex[h]];
+      if (sameText(m.id, key)) return &m;
+    }
     return nullptr;
   }
-  
-  String generateQuizHtml(const Module& module) {
-    if (!module.hasQuiz) return "";
-    String html = "<form id='quizForm'>";
-    for(int i=0; i<module.quizQuestionCount; i++) {
-        html += "<div class='q'><p>" + String(i+1) + ". " + module.quizQuestions[i].question + "</p>";
-        for(int j=0; j<module.quizQuestions[i].optionCount; j++) {
-            html += "<label><input type='radio' name='q" + String(i) + "' value='" + String((char)('a'+j)) + "'> " + module.quizQuestions[i].options[j] + "</label><br>";
-        }
-        html += "</div>";
+  const Lesson& getLesson(const Module& m, int i) const { return content->lessons[m.firstLesson + i]; }
+
+  // The module's lesson with this id, or nullptr.
+  const Lesson* findLesson(const Module& m, int32_t id) const {
+    const Lesson* lessons = content->lessons + m.firstLesson;
+    if (m.slotCount > 0) {
+      if (id < m.minLessonId || (uint32_t)(id - m.minLessonId) >= m.slotCount) return nullptr;
+      uint16_t slot = content->lessonSlots[m.firstSlot + (id - m.minLessonId)];
+      return slot == LESSON_SLOT_EMPTY ? nullptr : &lessons[slot];
+    }
+    uint32_t lo = 0, hi = m.lessonCount;
+    while (lo < hi) {
+      uint32_t mid = (lo + hi) / 2;
+      if (lessons[mid].id < id) lo = mid + 1; else hi = mid;
     }
-    html += "<br><button type='button' onclick='gradeQuiz()'>Submit</button></form><div id='result'></div>";
-    html += "<script>function gradeQuiz(){var s=0;var t=" + String(module.quizQuestionCount) + ";var f=document.forms['quizForm'];";
-    for(int i=0; i<module.quizQuestionCount; i++) {
-        html += "if(f.elements['q" + String(i) + "'].value=='" + String(module.quizQuestions[i].correctAnswer) + "')s++;";
+    return (lo < m.lessonCount && lessons[lo].id == id) ? &lessons[lo] : nullptr;
+  }
+  const QuizQuestion& getQuestion(const Module& m, int i) const { return content->questions[m.firstQuestion + i]; }
+
+  // Decodes q's question and options into text.spans; false if the block
+  // cannot be read or does not check out.
+  bool readQuestion(const QuizQuestion& q, QuizText& text) {
+    const char* block = q.block;
+    if (!block) {
+      if (!text.pack) text.pack = SPIFFS.open(CONTENT_PACK_PATH, "r");
+      if (!text.pack || !text.pack.seek(q.blockOffset) ||
+          text.pack.read((uint8_t*)text.buf, q.blockLength) != q.blockLength) return false;
+      block = text.buf;
     }
-    html += "document.getElementById('result').innerHTML='Score: '+s+'/'+t;}</script>";
-    return html;
+    text.spans.correctAnswer = q.correctAnswer;
+    return quizBlockDecode(block, q.blockLength, q.optionCount, text.spans);
   }
 
+  static String str(TextSpan s) {
+    String result;
+    result.reserve(s.len);
+    result.concat(s.ptr, s.len);
+    return result;
+  }
+
+  // Heap held by the current content generation.
+  size_t getContentBytes() const { return content->arena.bytesReserved(); }
+
+  // Writes the rendered HTML of a lesson to out. Pack bodies are copied from
+  // flash as they are; Markdown lessons come from the cache or are rendered
+  // straight into out and cached afterwards.
+  void writeLessonHtml(const Module& module, const Lesson& lesson, ChunkedWriter& out) {
+    if (lesson.bodyLength > 0) { streamPackBody(lesson, out); return; }
+
+    // Keyed by the source hash, so unchanged lessons stay cached across reloads
+    uint32_t key = lesson.hash;
+    const String* cached = lessonCache.get(key);
+    if (cached) { out.write(*cached); return; }
+
+    size_t before = out.bytesWritten();
+    String html = renderLessonFile(lesson, out);
+    Serial.println("Rendered lesson " + str(module.id) + "/" + String(lesson.id) + " (" + String(out.bytesWritten() - before) + " bytes)");
+    if (html.length() > 0) lessonCache.put(key, html);
+  }
+
+  const LessonCacheStats& getLessonCacheStats() const { return lessonCache.getStats(); }
+  const BootProfile& getBootProfile() const { return profile; }
+  // Changes whenever the served content may have changed; caches built from
+  // it are stale once this differs.
+  uint32_t getGeneration() const { return generation; }
+  
   void printModuleInfo(int i) {
-    if (i < 0 || i >= moduleCount) return;
-    Serial.println("Module: " + modules[i].name + " (Lessons: " + String(modules[i].lessonCount) + ")");
+    const Module* m = getModule(i);
+    if (!m) return;
+    Serial.println("Module: " + str(m->name) + " (Lessons: " + String(m->lessonCount) + ")");
   }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,59 @@
+#ifndef FILE_BODY_H
+#define FILE_BODY_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SPIFFS.h>
+#include <new>
+#include "http_engine.h"
+
+// A response body read straight from flash as the client takes it: length
+// bytes of a file from offset, then a literal tail such as the closing tags
+// of a page. The file stays open until the response is done.
+class FileBody {
+private:
+  File file;
+  size_t fileLeft;
+  const char* tail;  // Must outlive the response, e.g. a string literal
+  size_t tailLeft;
+
+  FileBody(File f, size_t length, const char* t) : file(f), fileLeft(length), tail(t), tailLeft(strlen(t)) {}
+
+  static size_t read(void* ctx, char* buf, size_t cap) {
+    FileBody& b = *(FileBody*)ctx;
+    size_t n = 0;
+    if (b.fileLeft > 0) {
+      n = b.file.read((uint8_t*)buf, b.fileLeft < cap ? b.fileLeft : cap);
+      b.fileLeft -= n;
+      if (b.fileLeft > 0) return n;  // 0 here: the file is shorter than it was
+    }
+    size_t k = b.tailLeft < cap - n ? b.tailLeft : cap - n;
+    memcpy(buf + n, b.tail, k);
+    b.tail += k;
+    b.tailLeft -= k;
+    return n + k;
+  }
+
+  static void close(void* ctx) {
+    FileBody* b = (FileBody*)ctx;
+    b->file.close();
+    delete b;
+  }
+
+public:
+  // Sets body to read path as above. False if the file cannot be opened or
+  // positioned, or there is no heap for it.
+  static bool open(const char* path, size_t offset, size_t length, const char* tail, HttpBodySource& body) {
+    File file = SPIFFS.open(path, "r");
+    if (!file) return false;
+    FileBody* b = (offset == 0 || file.seek(offset)) ? new (std::nothrow) FileBody(file, length, tail) : nullptr;
+    if (!b) { file.close(); return false; }
+    body.read = read;
+    body.close = close;
+    body.ctx = b;
+    body.remaining = length + b->tailLeft;
+    return true;
+  }
+};
+
+#endif
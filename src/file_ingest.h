@@ -0,0 +1,54 @@
+#ifndef FILE_INGEST_H
+#define FILE_INGEST_H
+
+#include <stdlib.h>
+#include "content_format.h"
+
+#define INGEST_BLOCK_SIZE 4096
+
+// Reusable scratch buffer for reading whole files. It grows once to the
+// largest file seen and is then reused, so loading a file is one size query
+// and a few block reads instead of one read() and String append per byte.
+class IngestBuffer {
+private:
+  char* data;
+  size_t capacity;
+
+public:
+  IngestBuffer() : data(nullptr), capacity(0) {}
+  ~IngestBuffer() { release(); }
+
+  // Reads all of file and points view at the bytes. The view is read-only and
+  // valid until the next load() or release(). Works with any file type that
+  // has size() and read(uint8_t*, size_t), e.g. fs::File.
+  template <typename FileT>
+  bool load(FileT& file, TextSpan& view) {
+    size_t size = file.size();
+    if (size + 1 > capacity) {
+      char* grown = (char*)realloc(data, size + 1);
+      if (!grown) return false;
+      data = grown;
+      capacity = size + 1;
+    }
+    size_t got = 0;
+    while (got < size) {
+      size_t want = size - got < INGEST_BLOCK_SIZE ? size - got : INGEST_BLOCK_SIZE;
+      size_t n = file.read((uint8_t*)data + got, want);
+      if (n == 0) break;
+      got += n;
+    }
+    data[got] = '\0';
+    view = TextSpan(data, got);
+    return got == size;
+  }
+
+  void release() {
+    free(data);
+    data = nullptr;
+    capacity = 0;
+  }
+
+  size_t getCapacity() const { return capacity; }
+};
+
+#endif
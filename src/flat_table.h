@@ -0,0 +1,62 @@
+#ifndef FLAT_TABLE_H
+#define FLAT_TABLE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Growable array of plain structs (no constructors run, moved with realloc).
+// Fills while a content generation is built; capacity doubles, so up to
+// half of it can sit unused until the table is cleared.
+template <typename T>
+class FlatTable {
+private:
+  T* items;
+  uint32_t count;
+  uint32_t capacity;
+
+  bool reserve(uint32_t n) {
+    if (n <= capacity) return true;
+    uint32_t cap = capacity ? capacity * 2 : 8;
+    if (cap < n) cap = n;
+    T* grown = (T*)realloc(items, cap * sizeof(T));
+    if (!grown) return false;
+    items = grown;
+    capacity = cap;
+    return true;
+  }
+
+public:
+  FlatTable() : items(nullptr), count(0), capacity(0) {}
+  ~FlatTable() { free(items); }
+  FlatTable(const FlatTable&) = delete;
+  FlatTable& operator=(const FlatTable&) = delete;
+
+  // Appends n zeroed entries and returns the first, or nullptr when out of memory.
+  T* add(uint32_t n = 1) {
+    if (!reserve(count + n)) return nullptr;
+    T* first = items + count;
+    memset((void*)first, 0, n * sizeof(T));
+    count += n;
+    return first;
+  }
+
+  // Drops the entries from n on; the capacity is kept.
+  void truncate(uint32_t n) {
+    if (n < count) count = n;
+  }
+
+  void clear() {
+    free(items);
+    items = nullptr;
+    count = capacity = 0;
+  }
+
+  T& operator[](uint32_t i) { return items[i]; }
+  const T& operator[](uint32_t i) const { return items[i]; }
+  T* data() { return items; }
+  const T* data() const { return items; }
+  uint32_t size() const { return count; }
+};
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef GZIP_WRITER_H
+#define GZIP_WRITER_H
+
+// Small gzip encoder for pages that are compressed once and served many
+// times. One fixed-Huffman deflate block with a single-probe LZ77 match
+// finder: a few KB of scratch instead of the hundreds zlib needs, at the
+// cost of some ratio. Plain C++ so tools/contentc measures the same output.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef GZIP_HASH_BITS
+#define GZIP_HASH_BITS 10
+#endif
+#define GZIP_WINDOW 32768
+#define GZIP_MIN_MATCH 3
+#define GZIP_MAX_MATCH 258
+
+// Receives compressed bytes as they are produced.
+typedef void (*GzipSink)(const uint8_t* data, size_t len, void* ctx);
+
+class GzipWriter {
+private:
+  GzipSink sink;
+  void* ctx;
+  uint8_t buf[128];
+  size_t used;
+  uint32_t bits;
+  int bitCount;
+  size_t total;
+
+  void putByte(uint8_t b) {
+    buf[used++] = b;
+    total++;
+    if (used == sizeof(buf)) { sink(buf, used, ctx); used = 0; }
+  }
+
+  // Deflate packs values LSB first.
+  void putBits(uint32_t value, int n) {
+    bits |= value << bitCount;
+    bitCount += n;
+    while (bitCount >= 8) {
+      putByte((uint8_t)bits);
+      bits >>= 8;
+      bitCount -= 8;
+    }
+  }
+
+  // Huffman codes are defined MSB first, so they go out reversed.
+  void putCode(uint32_t code, int n) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < n; i++) { reversed = (reversed << 1) | (code & 1); code >>= 1; }
+    putBits(reversed, n);
+  }
+
+  // Fixed literal/length code (RFC 1951, 3.2.6).
+  void putSymbol(int sym) {
+    if (sym < 144) putCode(0x30 + sym, 8);
+    else if (sym < 256) putCode(0x190 + sym - 144, 9);
+    else if (sym < 280) putCode(sym - 256, 7);
+    else putCode(0xC0 + sym - 280, 8);
+  }
+
+  void putMatch(int length, int distance) {
+    static const uint16_t lengthBase[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                           35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const uint8_t lengthExtra[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                           3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const uint16_t distBase[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                         257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                         8193, 12289, 16385, 24577 };
+    static const uint8_t distExtra[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                         7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    int l = 28;
+    while (lengthBase[l] > length) l--;
+    putSymbol(257 + l);
+    putBits(length - lengthBase[l], lengthExtra[l]);
+    int d = 29;
+    while (distBase[d] > distance) d--;
+    putCode(d, 5);
+    putBits(distance - distBase[d], distExtra[d]);
+  }
+
+  static uint32_t hash3(const uint8_t* p) {
+    uint32_t v = p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16);
+    return (v * 2654435761u) >> (32 - GZIP_HASH_BITS);
+  }
+
+public:
+  GzipWriter(GzipSink s, void* c) : sink(s), ctx(c), used(0), bits(0), bitCount(0), total(0) {}
+
+  static uint32_t crc32(const uint8_t* data, size_t len) {
+    static const uint32_t table[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+      0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C };
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+      crc ^= data[i];
+      crc = (crc >> 4) ^ table[crc & 15];
+      crc = (crc >> 4) ^ table[crc & 15];
+    }
+    return ~crc;
+  }
+
+  // Writes one complete gzip member for text. Returns false if the match
+  // table could not be allocated; nothing has been written then.
+  bool compress(const char* text, size_t len) {
+    uint32_t* head = (uint32_t*)calloc(1u << GZIP_HASH_BITS, sizeof(uint32_t));  // Position + 1, 0 = empty
+    if (!head) return false;
+    const uint8_t* src = (const uint8_t*)text;
+    static const uint8_t header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+    for (size_t i = 0; i < sizeof(header); i++) putByte(header[i]);
+
+    putBits(1, 1);  // BFINAL
+    putBits(1, 2);  // BTYPE = fixed Huffman
+    size_t i = 0;
+    while (i < len) {
+      int best = 0;
+      if (i + GZIP_MIN_MATCH <= len) {
+        uint32_t h = hash3(src + i);
+        size_t cand = head[h];
+        head[h] = (uint32_t)i + 1;
+        if (cand && i - (cand - 1) <= GZIP_WINDOW) {
+          const uint8_t* a = src + cand - 1;
+          size_t limit = len - i < GZIP_MAX_MATCH ? len - i : GZIP_MAX_MATCH;
+          while ((size_t)best < limit && a[best] == src[i + best]) best++;
+          if (best >= GZIP_MIN_MATCH) putMatch(best, (int)(i - (cand - 1)));
+        }
+      }
+      if (best < GZIP_MIN_MATCH) { putSymbol(src[i]); i++; continue; }
+      // Index the positions the match covers so later text can refer to them
+      for (size_t j = i + 1; j < i + best && j + GZIP_MIN_MATCH <= len; j++) head[hash3(src + j)] = (uint32_t)j + 1;
+      i += best;
+    }
+    putSymbol(256);
+    if (bitCount > 0) putBits(0, 8 - bitCount);
+    free(head);
+
+    uint32_t crc = crc32(src, len);
+    for (int k = 0; k < 4; k++) putByte((uint8_t)(crc >> (8 * k)));
+    for (int k = 0; k < 4; k++) putByte((uint8_t)((uint32_t)len >> (8 * k)));
+    if (used > 0) { sink(buf, used, ctx); used = 0; }
+    return true;
+  }
+
+  size_t bytesWritten() const { return total; }
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef HTML_TEMPLATE_H
+#define HTML_TEMPLATE_H
+
+// Page skeletons as constexpr string literals with "{}" slots. Each slot
+// has a type that fixes both the value it takes and how that value is
+// escaped, and rendering writes literal text and slot values straight into
+// an output sink, so building a page allocates nothing. Any sink with
+// write(const char*, size_t) and write(const char*) works, e.g. ChunkedWriter.
+//
+//   HTML_TEMPLATE(LINK, "<a href='/m?id={}'>{}</a>", UrlSlot, TextSlot);
+//   renderHtml(out, LINK, m.id, m.name);
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "content_format.h"
+
+// Text between tags: & < > escaped.
+struct TextSlot {
+  typedef TextSpan Value;
+  template <typename Out>
+  static void write(Out& out, TextSpan v) {
+    size_t run = 0;
+    for (size_t i = 0; i < v.len; i++) {
+      const char* entity = v.ptr[i] == '&' ? "&amp;" : v.ptr[i] == '<' ? "&lt;" : v.ptr[i] == '>' ? "&gt;" : nullptr;
+      if (!entity) continue;
+      out.write(v.ptr + run, i - run);
+      out.write(entity);
+      run = i + 1;
+    }
+    out.write(v.ptr + run, v.len - run);
+  }
+};
+
+// Attribute values in single or double quotes.
+struct AttrSlot {
+  typedef TextSpan Value;
+  template <typename Out>
+  static void write(Out& out, TextSpan v) {
+    size_t run = 0;
+    for (size_t i = 0; i < v.len; i++) {
+      char c = v.ptr[i];
+      const char* entity = c == '&' ? "&amp;" : c == '<' ? "&lt;" : c == '>' ? "&gt;"
+                         : c == '\'' ? "&#39;" : c == '"' ? "&quot;" : nullptr;
+      if (!entity) continue;
+      out.write(v.ptr + run, i - run);
+      out.write(entity);
+      run = i + 1;
+    }
+    out.write(v.ptr + run, v.len - run);
+  }
+};
+
+// A query parameter value inside an attribute: percent-encodes everything
+// but unreserved characters, which also keeps it safe as an attribute.
+struct UrlSlot {
+  typedef TextSpan Value;
+  template <typename Out>
+  static void write(Out& out, TextSpan v) {
+    static const char hex[] = "0123456789ABCDEF";
+    size_t run = 0;
+    for (size_t i = 0; i < v.len; i++) {
+      unsigned char c = (unsigned char)v.ptr[i];
+      if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+          c == '-' || c == '_' || c == '.' || c == '~') continue;
+      char esc[3] = { '%', hex[c >> 4], hex[c & 15] };
+      out.write(v.ptr + run, i - run);
+      out.write(esc, 3);
+      run = i + 1;
+    }
+    out.write(v.ptr + run, v.len - run);
+  }
+};
+
+struct IntSlot {
+  typedef int32_t Value;
+  template <typename Out>
+  static void write(Out& out, int32_t v) {
+    char digits[12];
+    int n = snprintf(digits, sizeof(digits), "%d", (int)v);
+    out.write(digits, n);
+  }
+};
+
+template <typename... Slots>
+struct HtmlTemplate {
+  const char* text;
+  static constexpr size_t slotCount = sizeof...(Slots);
+};
+
+constexpr size_t htmlSlotCount(const char* s) {
+  return !s[0] ? 0 : (s[0] == '{' && s[1] == '}') ? 1 + htmlSlotCount(s + 2) : htmlSlotCount(s + 1);
+}
+
+// Declares a template and checks at compile time that the text has one
+// "{}" per slot type.
+#define HTML_TEMPLATE(name, literal, ...) \
+  constexpr HtmlTemplate<__VA_ARGS__> name = { literal }; \
+  static_assert(htmlSlotCount(literal) == HtmlTemplate<__VA_ARGS__>::slotCount, #name ": slots do not match the text")
+
+template <typename Out>
+inline void htmlRenderSlots(Out&, const char*&) {}
+
+template <typename Slot, typename... Rest, typename Out, typename V, typename... Vs>
+inline void htmlRenderSlots(Out& out, const char*& p, const V& v, const Vs&... rest) {
+  const char* slot = strstr(p, "{}");  // Present: the count was checked at compile time
+  out.write(p, slot - p);
+  Slot::write(out, v);
+  p = slot + 2;
+  htmlRenderSlots<Rest...>(out, p, rest...);
+}
+
+template <typename Out, typename... Slots>
+inline void renderHtml(Out& out, const HtmlTemplate<Slots...>& tpl, typename Slots::Value... values) {
+  const char* p = tpl.text;
+  htmlRenderSlots<Slots...>(out, p, values...);
+  out.write(p);
+}
+
+#endif
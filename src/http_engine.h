@@ -0,0 +1,634 @@
+#ifndef HTTP_ENGINE_H
+#define HTTP_ENGINE_H
+
+// Event-driven HTTP/1.1 core: one listening socket and a fixed table of
+// non-blocking connections, each a small state machine (read request ->
+// write response -> read the next one or close) advanced by poll(). A slow
+// client only holds its own slot. Plain C++ on BSD sockets, so the same code runs on lwIP
+// (ESP32) and on Linux.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#ifdef ARDUINO
+#include <lwip/sockets.h>
+#else
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#include "content_format.h"
+
+// lwIP allows 10 sockets by default; the listener and DNS take two of them.
+#ifndef HTTP_MAX_CONNECTIONS
+#define HTTP_MAX_CONNECTIONS 8
+#endif
+// Clients waiting for a free connection slot queue here instead of having
+// their SYN dropped (a 1 s retry). The stack caps it at what it can hold.
+#ifndef HTTP_LISTEN_BACKLOG
+#define HTTP_LISTEN_BACKLOG 64
+#endif
+#ifndef HTTP_REQUEST_BUFFER
+#define HTTP_REQUEST_BUFFER 2048
+#endif
+#ifndef HTTP_IDLE_TIMEOUT_MS
+#define HTTP_IDLE_TIMEOUT_MS 5000
+#endif
+// How long a kept-alive connection may wait for its next request, and how
+// many requests it may carry. HTTP_KEEPALIVE_MAX_REQUESTS 1 turns
+// keep-alive off.
+#ifndef HTTP_KEEPALIVE_TIMEOUT_MS
+#define HTTP_KEEPALIVE_TIMEOUT_MS 3000
+#endif
+#ifndef HTTP_KEEPALIVE_MAX_REQUESTS
+#define HTTP_KEEPALIVE_MAX_REQUESTS 100
+#endif
+#define HTTP_MAX_ARGS 16
+// Response bytes a connection buffers before it starts sending. Past the
+// window the handler's writes go out as far as the socket takes them, and
+// what it does not take grows the buffer, up to HTTP_OUTPUT_MAX; beyond that
+// the response fails. Nothing ever waits for a client, as that would hold up
+// every other connection. Bodies that already exist in full (files, cached
+// pages) are not written by the handler but read from an HttpBodySource as
+// the client takes them, a window at a time.
+#ifndef HTTP_OUTPUT_WINDOW
+#define HTTP_OUTPUT_WINDOW 8192
+#endif
+#ifndef HTTP_OUTPUT_MAX
+#define HTTP_OUTPUT_MAX 32768
+#endif
+// Body windows one connection may send per pass before the others' turn.
+#ifndef HTTP_WRITE_REFILLS
+#define HTTP_WRITE_REFILLS 4
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+enum HttpMethod { METHOD_ANY, METHOD_GET, METHOD_HEAD, METHOD_POST, METHOD_OTHER };
+
+struct HttpArg {
+  TextSpan name;
+  TextSpan value;
+};
+
+// A parsed request. All spans point into the connection's request buffer
+// and are valid while the handler runs.
+struct HttpRequest {
+  HttpMethod method;
+  TextSpan path;     // Percent-decoded, without the query
+  TextSpan headers;  // Raw header lines after the request line
+  TextSpan body;
+  HttpArg args[HTTP_MAX_ARGS];  // Query and form arguments, decoded
+  int argCount;
+  bool http11;     // Client speaks HTTP/1.1: chunked bodies allowed
+  bool keepAlive;  // Connection stays open after the response; the handler may clear it
+
+  // Case-insensitive lookup of a header's value.
+  bool header(const char* name, TextSpan& value) const {
+    size_t n = strlen(name);
+    TextSpan rest = headers;
+    while (rest.len > 0) {
+      const char* nl = (const char*)memchr(rest.ptr, '\n', rest.len);
+      size_t lineLen = nl ? (size_t)(nl - rest.ptr) : rest.len;
+      TextSpan line(rest.ptr, lineLen);
+      rest = nl ? TextSpan(nl + 1, rest.len - lineLen - 1) : TextSpan(rest.ptr + lineLen, 0);
+      if (line.len > n && line.ptr[n] == ':' && strncasecmp(line.ptr, name, n) == 0) {
+        value = spanTrim(TextSpan(line.ptr + n + 1, line.len - n - 1));
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const HttpArg* arg(TextSpan name) const {
+    for (int i = 0; i < argCount; i++) {
+      if (args[i].name.len == name.len && memcmp(args[i].name.ptr, name.ptr, name.len) == 0) return &args[i];
+    }
+    return nullptr;
+  }
+};
+
+// The rest of a response body, read as the client takes it rather than
+// written by the handler: read() fills up to cap bytes at buf and returns
+// how many. remaining is what is still to come, counted in the response's
+// Content-Length; a read() of 0 before then cuts the response short and
+// closes the connection. close() is called once, when the body is done or
+// the connection goes away, and frees ctx.
+struct HttpBodySource {
+  size_t (*read)(void* ctx, char* buf, size_t cap);
+  void (*close)(void* ctx);
+  void* ctx;
+  size_t remaining;
+};
+
+// Response bytes of one connection, sent as fast as the socket takes them.
+// The buffer grows in doubling steps up to HTTP_OUTPUT_WINDOW; past that,
+// write() sends what the socket takes and grows the buffer by what it does
+// not. A body source, if any, follows the written bytes and is read into
+// the same buffer each time it has drained. Once a write fails (no heap,
+// over HTTP_OUTPUT_MAX, client gone) the output is marked failed, later
+// writes are dropped and the engine closes the connection rather than send
+// a truncated body as if it were complete.
+class HttpOutput {
+private:
+  char* data;
+  const char* fixed;  // Static bytes sent in place of data, or nullptr
+  size_t len;
+  size_t cap;
+  size_t sent;
+  int fd;             // Socket to send to once the window is full
+  bool broken;
+  bool hasBody;       // body is still to be read
+  HttpBodySource body;
+  uint32_t overflows; // Times write() grew the buffer past the window
+
+  bool grow(size_t limit) {
+    size_t grown = cap ? cap * 2 : 1024;
+    if (grown > limit) grown = limit;
+    if (grown <= cap) return false;
+    char* d = (char*)realloc(data, grown);
+    if (!d) return false;
+    data = d;
+    cap = grown;
+    return true;
+  }
+
+  // Frees space at the end of data: grows it up to the window, sends what
+  // the socket takes without waiting, or else grows it further.
+  bool makeRoom() {
+    if (cap < HTTP_OUTPUT_WINDOW) return grow(HTTP_OUTPUT_WINDOW);
+    if (fd >= 0 && sent < len) {
+      ssize_t n = send(fd, data + sent, len - sent, MSG_NOSIGNAL);
+      if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return false;
+      if (n > 0) sent += n;
+    }
+    if (sent > 0) {
+      memmove(data, data + sent, len - sent);
+      len -= sent;
+      sent = 0;
+      return true;
+    }
+    overflows++;
+    return grow(HTTP_OUTPUT_MAX);
+  }
+
+  void closeBody() {
+    if (!hasBody) return;
+    hasBody = false;
+    body.close(body.ctx);
+  }
+
+public:
+  HttpOutput() : data(nullptr), fixed(nullptr), len(0), cap(0), sent(0), fd(-1), broken(false), hasBody(false), overflows(0) {}
+  ~HttpOutput() { release(); }
+
+  // Lets write() send to the client once the window is full.
+  void attach(int socketFd) { fd = socketFd; }
+
+  // Sends source after what has been written; nothing may be written after
+  // it. Takes ownership: source is closed even if the output has failed.
+  void setBody(const HttpBodySource& source) {
+    body = source;
+    hasBody = true;
+    if (broken || body.remaining == 0) closeBody();
+  }
+
+  // Reads the next piece of the body once everything before it is sent.
+  // False if the body ended early or there is no heap for the buffer.
+  bool refill() {
+    if (!hasBody || sent < len) return true;
+    if (fixed) { fixed = nullptr; len = 0; }
+    size_t want = body.remaining < HTTP_OUTPUT_WINDOW ? body.remaining : HTTP_OUTPUT_WINDOW;
+    while (cap < want && grow(want)) {}
+    if (cap == 0) { broken = true; closeBody(); return false; }
+    size_t n = body.read(body.ctx, data, want < cap ? want : cap);
+    len = n;
+    sent = 0;
+    if (n == 0) { broken = true; closeBody(); return false; }
+    body.remaining -= n;
+    if (body.remaining == 0) closeBody();
+    return true;
+  }
+
+  bool bodyPending() const { return hasBody; }
+
+  bool write(const char* p, size_t n) {
+    if (broken) return false;
+    if (fixed) {
+      // Appending to a fixed response: copy it into a buffer first
+      const char* f = fixed;
+      size_t fLen = len;
+      fixed = nullptr;
+      len = 0;
+      if (!write(f, fLen)) return false;
+    }
+    while (n > 0) {
+      if (len == cap && !makeRoom()) { broken = true; return false; }
+      size_t k = cap - len < n ? cap - len : n;
+      memcpy(data + len, p, k);
+      len += k;
+      p += k;
+      n -= k;
+    }
+    return true;
+  }
+
+  bool write(const char* s) { return write(s, strlen(s)); }
+
+  // Sends n bytes at p without copying them; p must stay valid until the
+  // response is out, e.g. a string literal.
+  void writeFixed(const char* p, size_t n) {
+    if (len > 0 || fixed) { write(p, n); return; }
+    fixed = p;
+    len = n;
+  }
+
+  const char* pending() const { return (fixed ? fixed : data) + sent; }
+  size_t pendingBytes() const { return len - sent; }
+  void consume(size_t n) { sent += n; }
+  size_t size() const { return len; }
+  bool failed() const { return broken; }
+  uint32_t getOverflows() const { return overflows; }
+
+  void release() {
+    closeBody();
+    free(data);
+    data = nullptr;
+    fixed = nullptr;
+    len = cap = sent = 0;
+    broken = false;
+  }
+};
+
+struct HttpEngineStats {
+  uint32_t accepted;
+  uint32_t served;
+  uint32_t reused;     // Requests served on a connection that had served one before
+  uint32_t timedOut;
+  uint32_t rejected;   // Malformed or oversized requests
+  uint32_t aborted;    // Responses cut off because a write failed
+  uint32_t overflows;  // Times a response outgrew the window as its client was slow
+  uint32_t active;
+  uint32_t peakActive;
+};
+
+// Called once per complete request; writes the whole response to out.
+typedef void (*HttpRequestHandler)(HttpRequest& req, HttpOutput& out, void* ctx);
+
+class HttpEngine {
+private:
+  enum State { FREE, READING, WRITING, DRAINING };
+
+  struct Connection {
+    int fd;
+    State state;
+    bool drain;  // Request was not read to the end: half-close and discard the rest
+    bool keepAlive;
+    uint32_t lastActive;
+    uint32_t requests;    // Served on this connection so far
+    size_t requestLen;    // Bytes of in[] taken by the request being answered
+    size_t inLen;
+    char in[HTTP_REQUEST_BUFFER + 1];  // + NUL, so decoded values are C strings too
+    HttpOutput out;
+  };
+
+  Connection conns[HTTP_MAX_CONNECTIONS];
+  int listenFd;
+  HttpRequestHandler handler;
+  void* ctx;
+  HttpEngineStats stats;
+
+  static uint32_t nowMillis() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+  }
+
+  static void setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  }
+
+  static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  // Decodes %XX and '+' in place and returns the shortened span.
+  static TextSpan urlDecode(char* p, size_t n, bool plusIsSpace) {
+    size_t w = 0;
+    for (size_t r = 0; r < n; r++) {
+      if (p[r] == '%' && r + 2 < n && hexValue(p[r + 1]) >= 0 && hexValue(p[r + 2]) >= 0) {
+        p[w++] = (char)(hexValue(p[r + 1]) * 16 + hexValue(p[r + 2]));
+        r += 2;
+      } else {
+        p[w++] = (plusIsSpace && p[r] == '+') ? ' ' : p[r];
+      }
+    }
+    return TextSpan(p, w);
+  }
+
+  // Splits "a=1&b=2" into decoded arguments.
+  static void parseArgs(char* p, size_t n, HttpRequest& req) {
+    size_t pos = 0;
+    while (pos < n && req.argCount < HTTP_MAX_ARGS) {
+      char* amp = (char*)memchr(p + pos, '&', n - pos);
+      size_t end = amp ? (size_t)(amp - p) : n;
+      if (end > pos) {
+        char* eq = (char*)memchr(p + pos, '=', end - pos);
+        size_t nameEnd = eq ? (size_t)(eq - p) : end;
+        HttpArg& a = req.args[req.argCount++];
+        a.name = urlDecode(p + pos, nameEnd - pos, true);
+        a.value = eq ? urlDecode(eq + 1, end - nameEnd - 1, true) : TextSpan();
+      }
+      pos = end + 1;
+    }
+  }
+
+  static TextSpan headerValue(const char* head, size_t headLen, const char* name) {
+    HttpRequest probe;
+    probe.headers = TextSpan(head, headLen);
+    TextSpan value;
+    return probe.header(name, value) ? value : TextSpan();
+  }
+
+  // Whether a comma-separated header value lists token, ignoring case.
+  static bool hasToken(TextSpan value, const char* token) {
+    size_t n = strlen(token);
+    for (size_t i = 0; i + n <= value.len; i++) {
+      if (strncasecmp(value.ptr + i, token, n) == 0 && (i == 0 || value.ptr[i - 1] == ' ' || value.ptr[i - 1] == ',') &&
+          (i + n == value.len || value.ptr[i + n] == ',' || value.ptr[i + n] == ' ')) return true;
+    }
+    return false;
+  }
+
+  void respondError(Connection& c, const char* status) {
+    char msg[96];
+    int n = snprintf(msg, sizeof(msg), "HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status);
+    c.out.write(msg, n);
+    c.state = WRITING;
+    c.drain = true;  // Closing with unread input would reset the connection and lose the reply
+    stats.rejected++;
+  }
+
+  // Answers the first request in the buffer once all of it is there; until
+  // then waits for more. Pipelined requests after it wait in the buffer until
+  // this response is sent.
+  void tryDispatch(Connection& c) {
+    c.in[c.inLen] = '\0';
+    char* headEnd = strstr(c.in, "\r\n\r\n");
+    if (!headEnd) {
+      if (c.inLen >= HTTP_REQUEST_BUFFER) respondError(c, "431 Request Header Fields Too Large");
+      return;
+    }
+    size_t headLen = headEnd - c.in;
+    size_t bodyStart = headLen + 4;
+    const char* lineEnd = (const char*)memchr(c.in, '\r', headLen + 1);
+    TextSpan headers(lineEnd + 2, headLen > (size_t)(lineEnd - c.in) + 2 ? headLen - (lineEnd - c.in) - 2 : 0);
+    TextSpan lengthField = headerValue(headers.ptr, headers.len, "Content-Length");
+    size_t bodyLen = 0;
+    if (lengthField.len > 0) {
+      char digits[16];
+      size_t n = lengthField.len < sizeof(digits) - 1 ? lengthField.len : sizeof(digits) - 1;
+      memcpy(digits, lengthField.ptr, n);
+      digits[n] = '\0';
+      bodyLen = strtoul(digits, nullptr, 10);
+    }
+    if (bodyLen > HTTP_REQUEST_BUFFER || bodyStart + bodyLen > HTTP_REQUEST_BUFFER) { respondError(c, "413 Payload Too Large"); return; }
+    if (c.inLen < bodyStart + bodyLen) return;
+
+    HttpRequest req;
+    req.argCount = 0;
+    req.headers = headers;
+    req.body = TextSpan(c.in + bodyStart, bodyLen);
+    // Request line: METHOD SP target SP version
+    char* sp1 = (char*)memchr(c.in, ' ', lineEnd - c.in);
+    char* sp2 = sp1 ? (char*)memchr(sp1 + 1, ' ', lineEnd - sp1 - 1) : nullptr;
+    if (!sp1 || !sp2 || sp1[1] != '/') { respondError(c, "400 Bad Request"); return; }
+    TextSpan verb(c.in, sp1 - c.in);
+    TextSpan version(sp2 + 1, lineEnd - sp2 - 1);
+    TextSpan connection = headerValue(headers.ptr, headers.len, "Connection");
+    req.http11 = !(version.len == 8 && memcmp(version.ptr, "HTTP/1.0", 8) == 0);
+    req.keepAlive = (req.http11 ? !hasToken(connection, "close") : hasToken(connection, "keep-alive")) &&
+                    c.requests + 1 < HTTP_KEEPALIVE_MAX_REQUESTS;
+    req.method = (verb.len == 3 && memcmp(verb.ptr, "GET", 3) == 0) ? METHOD_GET
+               : (verb.len == 4 && memcmp(verb.ptr, "HEAD", 4) == 0) ? METHOD_HEAD
+               : (verb.len == 4 && memcmp(verb.ptr, "POST", 4) == 0) ? METHOD_POST : METHOD_OTHER;
+    char* target = sp1 + 1;
+    char* q = (char*)memchr(target, '?', sp2 - target);
+    req.path = urlDecode(target, (q ? q : sp2) - target, false);
+    if (q) parseArgs(q + 1, sp2 - q - 1, req);
+    TextSpan type = headerValue(headers.ptr, headers.len, "Content-Type");
+    if (req.method == METHOD_POST && bodyLen > 0 && spanStartsWith(type, "application/x-www-form-urlencoded")) {
+      // Decoded in place: the arguments are valid, req.body no longer holds the raw form
+      parseArgs(c.in + bodyStart, bodyLen, req);
+    }
+
+    c.out.attach(c.fd);
+    uint32_t overflowsBefore = c.out.getOverflows();
+    handler(req, c.out, ctx);
+    stats.overflows += c.out.getOverflows() - overflowsBefore;
+    if (c.out.failed()) {
+      stats.aborted++;
+      closeConnection(c);
+      return;
+    }
+    c.state = WRITING;
+    c.keepAlive = req.keepAlive;
+    c.requestLen = bodyStart + bodyLen;
+    if (c.requests++ > 0) stats.reused++;
+    stats.served++;
+  }
+
+  // The response is out: moves any pipelined bytes to the front and answers
+  // the next request if it is already complete.
+  void nextRequest(Connection& c) {
+    c.inLen -= c.requestLen;
+    memmove(c.in, c.in + c.requestLen, c.inLen);
+    c.requestLen = 0;
+    c.out.release();
+    c.state = READING;
+    if (c.inLen > 0) tryDispatch(c);
+  }
+
+  void closeConnection(Connection& c) {
+    close(c.fd);
+    c.fd = -1;
+    c.state = FREE;
+    c.inLen = 0;
+    c.out.release();
+    stats.active--;
+  }
+
+  static bool idleKeptAlive(const Connection& c) { return c.state == READING && c.requests > 0 && c.inLen == 0; }
+
+  // A free slot, or else the kept-alive connection idle the longest: a
+  // client waiting to connect beats one that may not come back.
+  Connection* freeSlot() {
+    Connection* idle = nullptr;
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+      Connection& c = conns[i];
+      if (c.state == FREE) return &c;
+      if (idleKeptAlive(c) && (!idle || (int32_t)(c.lastActive - idle->lastActive) < 0)) idle = &c;
+    }
+    return idle;
+  }
+
+  void acceptClients() {
+    while (true) {
+      Connection* slot = freeSlot();
+      if (!slot) return;  // The rest wait in the listen backlog
+      int fd = accept(listenFd, nullptr, nullptr);
+      if (fd < 0) return;
+      if (slot->state != FREE) closeConnection(*slot);
+      setNonBlocking(fd);
+      // Each response goes out in one send(); don't hold it back for the ACK
+      // of the previous one on a kept-alive connection
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      slot->fd = fd;
+      slot->state = READING;
+      slot->drain = false;
+      slot->keepAlive = false;
+      slot->requests = 0;
+      slot->requestLen = 0;
+      slot->inLen = 0;
+      slot->lastActive = nowMillis();
+      stats.accepted++;
+      if (++stats.active > stats.peakActive) stats.peakActive = stats.active;
+    }
+  }
+
+  void readFrom(Connection& c) {
+    if (c.state == DRAINING) {
+      char scratch[256];
+      ssize_t n = recv(c.fd, scratch, sizeof(scratch), 0);
+      if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) closeConnection(c);
+      return;
+    }
+    ssize_t n = recv(c.fd, c.in + c.inLen, HTTP_REQUEST_BUFFER - c.inLen, 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) { closeConnection(c); return; }
+    if (n < 0) return;
+    c.inLen += n;
+    c.lastActive = nowMillis();
+    tryDispatch(c);
+  }
+
+  // Sends what the socket takes, reading more of the body each time the
+  // buffer has drained, up to HTTP_WRITE_REFILLS windows a call, so
+  // connections with long bodies take turns.
+  void writeTo(Connection& c) {
+    for (int i = 0; i < HTTP_WRITE_REFILLS; i++) {
+      if (!c.out.refill()) { stats.aborted++; closeConnection(c); return; }
+      if (c.out.pendingBytes() == 0) break;
+      ssize_t n = send(c.fd, c.out.pending(), c.out.pendingBytes(), MSG_NOSIGNAL);
+      if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) { closeConnection(c); return; }
+      if (n <= 0) break;
+      c.out.consume(n);
+      c.lastActive = nowMillis();
+      if (c.out.pendingBytes() > 0) break;  // The socket is full
+    }
+    if (c.out.pendingBytes() > 0 || c.out.bodyPending()) return;
+    if (!c.drain && c.keepAlive) { nextRequest(c); return; }
+    if (!c.drain) { closeConnection(c); return; }
+    shutdown(c.fd, SHUT_WR);
+    c.state = DRAINING;
+  }
+
+public:
+  HttpEngine() : listenFd(-1), handler(nullptr), ctx(nullptr) {
+    memset(&stats, 0, sizeof(stats));
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) { conns[i].fd = -1; conns[i].state = FREE; conns[i].inLen = 0; }
+  }
+
+  bool begin(uint16_t port, HttpRequestHandler h, void* c) {
+    handler = h;
+    ctx = c;
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) return false;
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, HTTP_LISTEN_BACKLOG) < 0) {
+      close(listenFd);
+      listenFd = -1;
+      return false;
+    }
+    setNonBlocking(listenFd);
+    return true;
+  }
+
+  // Does whatever socket work is ready without waiting; call from loop().
+  // timeoutMs > 0 lets a dedicated thread sleep until there is work.
+  void poll(uint32_t timeoutMs = 0) {
+    if (listenFd < 0) return;
+    fd_set rd, wr;
+    FD_ZERO(&rd);
+    FD_ZERO(&wr);
+    int maxFd = listenFd;
+    FD_SET(listenFd, &rd);
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+      Connection& c = conns[i];
+      if (c.state == READING || c.state == DRAINING) FD_SET(c.fd, &rd);
+      else if (c.state == WRITING) FD_SET(c.fd, &wr);
+      else continue;
+      if (c.fd > maxFd) maxFd = c.fd;
+    }
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    int ready = select(maxFd + 1, &rd, &wr, nullptr, &tv);
+    if (ready > 0) {
+      for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        Connection& c = conns[i];
+        if ((c.state == READING || c.state == DRAINING) && FD_ISSET(c.fd, &rd)) readFrom(c);
+        // A request answered above is written in the same pass
+        if (c.state == WRITING && (FD_ISSET(c.fd, &wr) || c.out.pendingBytes() > 0)) writeTo(c);
+      }
+      if (FD_ISSET(listenFd, &rd)) acceptClients();
+    }
+    uint32_t now = nowMillis();
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+      Connection& c = conns[i];
+      if (c.state == FREE) continue;
+      if (idleKeptAlive(c)) {
+        if (now - c.lastActive > HTTP_KEEPALIVE_TIMEOUT_MS) closeConnection(c);
+      } else if (now - c.lastActive > HTTP_IDLE_TIMEOUT_MS) {
+        stats.timedOut++;
+        closeConnection(c);
+      }
+    }
+  }
+
+  // Responses built but not yet fully sent, and the bytes they hold.
+  uint32_t queuedResponses(size_t& bytes) const {
+    uint32_t n = 0;
+    bytes = 0;
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+      const Connection& c = conns[i];
+      if (c.state != WRITING || (c.out.pendingBytes() == 0 && !c.out.bodyPending())) continue;
+      n++;
+      bytes += c.out.size();
+    }
+    return n;
+  }
+
+  const HttpEngineStats& getStats() const { return stats; }
+};
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <Arduino.h>
+#include "admission_control.h"
+#include "captive_probes.h"
+#include "http_engine.h"
+
+#ifndef CONTENT_LENGTH_UNKNOWN
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#endif
+#define HTTP_MAX_ROUTES 16
+
+// Whether an If-None-Match value names tag, a quoted entity tag as sent in
+// ETag: "*", or any tag of its comma-separated list, weak (W/) ones
+// included, as If-None-Match compares them weakly.
+inline bool etagListed(TextSpan header, const char* tag) {
+  size_t tagLen = strlen(tag);
+  size_t start = 0;
+  bool quoted = false;
+  for (size_t i = 0; i <= header.len; i++) {
+    if (i < header.len && (header.ptr[i] != ',' || quoted)) {
+      if (header.ptr[i] == '"') quoted = !quoted;
+      continue;
+    }
+    TextSpan item = spanTrim(TextSpan(header.ptr + start, i - start));
+    if (spanStartsWith(item, "W/")) item = TextSpan(item.ptr + 2, item.len - 2);
+    if (item.len == 1 && item.ptr[0] == '*') return true;
+    if (item.len == tagLen && memcmp(item.ptr, tag, tagLen) == 0) return true;
+    start = i + 1;
+  }
+  return false;
+}
+
+// WebServer-style front end for HttpEngine. Routes and the calls handlers
+// make (arg(), header(), send(), sendContent()...) work as with the Arduino
+// WebServer, but they act on the request being dispatched, and responses
+// are queued on its connection instead of blocking on the client. Every
+// response is delimited (length or chunks), so the connection can stay open
+// for the next request.
+//
+// With an AdmissionControl set, each request is checked against it before
+// its handler runs, using the route's cost estimate, and answered with 503
+// if the server is too busy for it. Captive-portal probes set with
+// setProbes() are answered before either.
+class HttpServer {
+public:
+  typedef void (*Handler)();
+  // Heap in bytes the request about to be handled will need; may use arg().
+  typedef size_t (*CostEstimate)();
+
+private:
+  struct Route {
+    const char* path;
+    HttpMethod method;
+    Handler handler;
+    CostEstimate cost;
+  };
+
+  HttpEngine engine;
+  uint16_t port;
+  Route routes[HTTP_MAX_ROUTES];
+  int routeCount;
+  Handler notFound;
+  CostEstimate notFoundCost;
+  AdmissionControl* admission;
+  CaptiveProbes* probes;
+
+  // State of the request being handled
+  HttpRequest* req;
+  HttpOutput* out;
+  String extraHeaders;
+  size_t contentLength;
+  bool chunked;
+  bool responded;
+
+  static const char* statusText(int code) {
+    switch (code) {
+      case 200: return "OK";
+      case 204: return "No Content";
+      case 302: return "Found";
+      case 304: return "Not Modified";
+      case 400: return "Bad Request";
+      case 404: return "Not Found";
+      case 405: return "Method Not Allowed";
+      case 500: return "Internal Server Error";
+      case 503: return "Service Unavailable";
+      default: return "";
+    }
+  }
+
+  // Tells the client to come back shortly; the page reloads itself, as
+  // browsers ignore Retry-After. The connection is closed to free its slot.
+  void sendBusy() {
+    char page[112];
+    int n = snprintf(page, sizeof(page), "<html><head><meta http-equiv='refresh' content='%d'></head><body>Busy, retrying...</body></html>",
+                     ADMISSION_RETRY_AFTER_S);
+    req->keepAlive = false;
+    sendHeader("Retry-After", String(ADMISSION_RETRY_AFTER_S));
+    send_P(503, "text/html", page, n);
+  }
+
+  static void dispatch(HttpRequest& r, HttpOutput& o, void* ctx) { ((HttpServer*)ctx)->handle(r, o); }
+
+  void handle(HttpRequest& r, HttpOutput& o) {
+    if (probes && probes->answer(r, o)) return;
+    req = &r;
+    out = &o;
+    extraHeaders = String();
+    contentLength = 0;
+    chunked = false;
+    responded = false;
+    Handler h = notFound;
+    CostEstimate cost = notFoundCost;
+    for (int i = 0; i < routeCount; i++) {
+      const Route& route = routes[i];
+      if (strlen(route.path) == r.path.len && memcmp(route.path, r.path.ptr, r.path.len) == 0 &&
+          (route.method == METHOD_ANY || route.method == r.method ||
+           (route.method == METHOD_GET && r.method == METHOD_HEAD))) {
+        h = route.handler;
+        cost = route.cost;
+        break;
+      }
+    }
+    if (h && admission) {
+      size_t queuedBytes;
+      uint32_t queued = engine.queuedResponses(queuedBytes);
+      if (!admission->admit(cost ? cost() : ADMISSION_DEFAULT_COST, queued, queuedBytes)) {
+        sendBusy();
+        h = nullptr;
+      }
+    }
+    if (h) h();
+    if (!responded) send(500, "text/plain", "No response");
+    if (chunked) writeBody("0\r\n\r\n", 5);  // Handler did not end the stream
+    extraHeaders = String();
+    req = nullptr;
+    out = nullptr;
+  }
+
+  void writeHead(int code, const char* type, size_t length) {
+    char line[96];
+    int n = snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", code, statusText(code));
+    out->write(line, n);
+    if (type && type[0]) {
+      out->write("Content-Type: ");
+      out->write(type);
+      out->write("\r\n");
+    }
+    if (length == CONTENT_LENGTH_UNKNOWN) {
+      // HTTP/1.0 has no chunks: the body ends when the connection closes
+      if (req->http11) out->write("Transfer-Encoding: chunked\r\n");
+      else req->keepAlive = false;
+    } else {
+      n = snprintf(line, sizeof(line), "Content-Length: %u\r\n", (unsigned)length);
+      out->write(line, n);
+    }
+    out->write(extraHeaders.c_str(), extraHeaders.length());
+    out->write(req->keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+    responded = true;
+  }
+
+  // False once the response has failed (see HttpOutput); the engine then
+  // closes the connection, so the client never takes a cut-off body as whole.
+  bool writeBody(const char* data, size_t len) {
+    return req->method == METHOD_HEAD || out->write(data, len);
+  }
+
+public:
+  HttpServer(uint16_t listenPort) : port(listenPort), routeCount(0), notFound(nullptr), notFoundCost(nullptr), admission(nullptr),
+                                    probes(nullptr), req(nullptr), out(nullptr), contentLength(0), chunked(false), responded(false) {}
+
+  void on(const char* path, Handler handler, CostEstimate cost = nullptr) { on(path, METHOD_ANY, handler, cost); }
+  void on(const char* path, HttpMethod method, Handler handler, CostEstimate cost = nullptr) {
+    if (routeCount == HTTP_MAX_ROUTES) { Serial.println("Too many routes, ignoring " + String(path)); return; }
+    routes[routeCount].path = path;
+    routes[routeCount].method = method;
+    routes[routeCount].handler = handler;
+    routes[routeCount].cost = cost;
+    routeCount++;
+  }
+  void onNotFound(Handler handler, CostEstimate cost = nullptr) {
+    notFound = handler;
+    notFoundCost = cost;
+  }
+
+  // Checks every request against control before running its handler;
+  // nullptr turns the check off.
+  void setAdmission(AdmissionControl* control) { admission = control; }
+  void setProbes(CaptiveProbes* table) { probes = table; }
+
+  void begin() {
+    if (!engine.begin(port, dispatch, this)) Serial.println("HTTP server could not listen on port " + String(port));
+  }
+
+  // Serves whatever connections are ready. By default never waits for a
+  // client; a task of its own can pass timeoutMs to sleep until one is ready.
+  void handleClient(uint32_t timeoutMs = 0) { engine.poll(timeoutMs); }
+
+  // Kept for WebServer compatibility; every header is available anyway.
+  void collectHeaders(const char**, size_t) {}
+
+  // Request accessors, valid inside a handler
+  bool hasArg(const String& name) const { return req->arg(TextSpan(name.c_str(), name.length())) != nullptr; }
+  String arg(const String& name) const {
+    const HttpArg* a = req->arg(TextSpan(name.c_str(), name.length()));
+    return a ? spanString(a->value) : String();
+  }
+  // The raw argument value without copying it; empty if absent.
+  TextSpan argSpan(const char* name) const {
+    const HttpArg* a = req->arg(TextSpan(name, strlen(name)));
+    return a ? a->value : TextSpan();
+  }
+  String header(const String& name) const {
+    TextSpan value;
+    return req->header(name.c_str(), value) ? spanString(value) : String();
+  }
+  // The raw header value without copying it; empty if absent.
+  TextSpan headerSpan(const char* name) const {
+    TextSpan value;
+    return req->header(name, value) ? value : TextSpan();
+  }
+  String uri() const { return spanString(req->path); }
+  HttpMethod method() const { return req->method; }
+
+  static String spanString(TextSpan s) {
+    String result;
+    result.reserve(s.len);
+    result.concat(s.ptr, s.len);
+    return result;
+  }
+
+  // Response, valid inside a handler
+  void sendHeader(const String& name, const String& value, bool first = false) {
+    String line = name + ": " + value + "\r\n";
+    extraHeaders = first ? line + extraHeaders : extraHeaders + line;
+  }
+  void setContentLength(size_t length) { contentLength = length; }
+
+  void send(int code, const char* type = nullptr, const String& body = String()) {
+    if (contentLength == CONTENT_LENGTH_UNKNOWN) {
+      writeHead(code, type, CONTENT_LENGTH_UNKNOWN);
+      chunked = req->http11;
+      if (body.length() > 0) sendContent(body);
+      return;
+    }
+    send_P(code, type, body.c_str(), body.length());
+  }
+
+  void send_P(int code, const char* type, const char* data, size_t len) {
+    writeHead(code, type, len);
+    writeBody(data, len);
+  }
+
+  // A response whose body is prefix followed by body, read as the client
+  // takes it (see HttpBodySource), so the handler neither copies nor waits
+  // for it. body is closed here for HEAD or a failed response.
+  void sendBody(int code, const char* type, const HttpBodySource& body, const char* prefix = "", size_t prefixLen = 0) {
+    writeHead(code, type, prefixLen + body.remaining);
+    if (req->method == METHOD_HEAD || !writeBody(prefix, prefixLen)) { body.close(body.ctx); return; }
+    out->setBody(body);
+  }
+
+  // One chunk of a response started with CONTENT_LENGTH_UNKNOWN; len 0 ends it.
+  void sendContent(const char* data, size_t len) {
+    if (!chunked) { writeBody(data, len); return; }
+    char size[12];
+    int n = snprintf(size, sizeof(size), "%x\r\n", (unsigned)len);
+    // After a failed write the rest is dropped and the connection closed
+    bool ok = writeBody(size, n) && writeBody(data, len) && writeBody("\r\n", 2);
+    if (!ok || len == 0) chunked = false;
+  }
+  void sendContent(const String& s) { sendContent(s.c_str(), s.length()); }
+
+  const HttpEngineStats& getStats() const { return engine.getStats(); }
+};
+
+#endif
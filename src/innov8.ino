@@ -1,81 +1,613 @@
 #include <WiFi.h>
 #include <DNSServer.h>
-#include <WebServer.h>
 #include <SPIFFS.h>
 #include "md4c-html.h"
 #include "content_parser.h"
+#include "http_server.h"
+#include "response_cache.h"
+#include "admission_control.h"
+#include "captive_probes.h"
+#include "quiz_stats.h"
+#include "quiz_sampler.h"
+#include "html_template.h"
+#include "static_assets.h"
+#include "file_body.h"
+#include "spsc_queue.h"
+#include "task_runner.h"
 
 const char* ssid = "EduBridge";
 const char* password = "";
 
 const byte DNS_PORT = 53;
+// Questions per quiz page. Override with -DQUIZ_PAGE_SIZE=... in build_flags.
+#ifndef QUIZ_PAGE_SIZE
+#define QUIZ_PAGE_SIZE 10
+#endif
+// Override with -DHTTP_PORT=... for host builds, where 80 needs root.
+#ifndef HTTP_PORT
+#define HTTP_PORT 80
+#endif
+
+// DNS answers on the core that runs Wi-Fi, HTTP on the other one, so a long
+// page render never keeps a phone's connectivity check waiting. Override
+// with -D... in build_flags.
+#ifndef DNS_TASK_CORE
+#define DNS_TASK_CORE 0
+#endif
+#ifndef HTTP_TASK_CORE
+#define HTTP_TASK_CORE 1
+#endif
+// 0 serves both from loop(), one after the other, as before the tasks
+#ifndef SERVER_TASKS
+#define SERVER_TASKS 1
+#endif
+#define DNS_TASK_STACK 4096
+#define HTTP_TASK_STACK 8192  // Same as the Arduino loop task, which used to serve pages
+#define DNS_TASK_POLL_MS 2
+#define HTTP_TASK_POLL_MS 10
+
 DNSServer dnsServer;
-WebServer server(80);
+HttpServer server(HTTP_PORT);
 ContentParser contentParser;
+ResponseCache pageCache;
+
+uint32_t largestHeapBlock() { return ESP.getMaxAllocHeap(); }
+AdmissionControl admission(largestHeapBlock);
+QuizStatsTable quizStats;
+
+enum { ASSET_CSS, ASSET_JS, ASSET_COUNT };
+StaticAsset assetFiles[ASSET_COUNT] = { StaticAsset("/app.css", "text/css"), StaticAsset("/app.js", "application/javascript") };
+StaticAssets assets(assetFiles, ASSET_COUNT);
+
+// Connectivity checks, answered with a redirect so the OS shows the portal.
+CaptiveProbe probeTable[] = {
+  CAPTIVE_PROBE("/generate_204", CAPTIVE_REDIRECT),              // Android, Chrome
+  CAPTIVE_PROBE("/gen_204", CAPTIVE_REDIRECT),
+  CAPTIVE_PROBE("/hotspot-detect.html", CAPTIVE_REDIRECT),       // Apple
+  CAPTIVE_PROBE("/library/test/success.html", CAPTIVE_REDIRECT),
+  CAPTIVE_PROBE("/connecttest.txt", CAPTIVE_REDIRECT),           // Windows 10 and later
+  CAPTIVE_PROBE("/redirect", CAPTIVE_REDIRECT),
+  CAPTIVE_PROBE("/ncsi.txt", CAPTIVE_REDIRECT),                  // Older Windows
+  CAPTIVE_PROBE("/canonical.html", CAPTIVE_REDIRECT),            // Firefox
+  CAPTIVE_PROBE("/success.txt", CAPTIVE_REDIRECT),
+};
+CaptiveProbes probes(probeTable, sizeof(probeTable) / sizeof(probeTable[0]));
+
+// Lesson ETags are built from the lesson's source hash; the build time and
+// the asset version stand in for the page template around it.
+const char buildStamp[] = __DATE__ " " __TIME__;
+const uint32_t buildTag = contentHash(buildStamp, sizeof(buildStamp) - 1);
+
+// ChunkedWriter sink: each flush is one HTTP chunk, len == 0 ends the body.
+void sendChunk(const char* data, size_t len, void*) {
+  server.sendContent(data, len);
+}
+
+// ChunkedWriter sink that collects the page into a String.
+void appendChunk(const char* data, size_t len, void* ctx) {
+  ((String*)ctx)->concat(data, len);
+}
+
+bool acceptsGzip() {
+  return server.header("Accept-Encoding").indexOf("gzip") >= 0;
+}
+
+// Adds the ETag and answers 304 if the client already has this version.
+// The gzip variant gets its own ETag, as the bytes differ.
+bool sendNotModified(uint32_t etag, bool gzip) {
+  char tag[16];
+  snprintf(tag, sizeof(tag), gzip ? "\"%08x-gz\"" : "\"%08x\"", (unsigned)etag);
+  server.sendHeader("ETag", tag);
+  server.sendHeader("Cache-Control", "no-cache");
+  server.sendHeader("Vary", "Accept-Encoding");
+  if (!etagListed(server.headerSpan("If-None-Match"), tag)) return false;
+  pageCache.countNotModified();
+  server.send(304);
+  return true;
+}
+
+// The finished page for key, or nullptr if it has to be built. Pages from
+// an older content generation are dropped first.
+const CachedResponse* cachedPage(const String& key) {
+  pageCache.sync(contentParser.getGeneration());
+  return pageCache.get(key);
+}
+
+// A cached page larger than the output window is read out of the cache as
+// the client takes it; a smaller one is copied, as it never has to wait.
+void sendCachedBody(const CachedResponse& page, bool gzip) {
+  const String& bytes = gzip ? page.gzip : page.body;
+  HttpBodySource body;
+  if (bytes.length() > HTTP_OUTPUT_WINDOW && pageCache.openBody(page, gzip, body)) server.sendBody(200, "text/html", body);
+  else server.send_P(200, "text/html", bytes.c_str(), bytes.length());
+}
+
+void sendGzipBody(const CachedResponse& page) {
+  server.sendHeader("Content-Encoding", "gzip");
+  sendCachedBody(page, true);
+}
+
+void sendCachedPage(const CachedResponse& page) {
+  bool gzip = page.gzip.length() > 0 && acceptsGzip();
+  if (sendNotModified(page.etag, gzip)) return;
+  if (gzip) sendGzipBody(page);
+  else sendCachedBody(page, false);
+}
+
+// Sends a freshly built page and keeps it for the next request if it fits.
+void sendPage(const String& key, String& html) {
+  const CachedResponse* page = pageCache.put(key, html);
+  if (page) { sendCachedPage(*page); return; }
+  if (!sendNotModified(contentHash(html.c_str(), html.length()), false)) server.send(200, "text/html", html);
+}
+
+// Quiz pages are numbered from 1; out-of-range numbers get the nearest page.
+int quizPageCount(const QuizSampler& sample) { return sample.size() > 0 ? (sample.size() + QUIZ_PAGE_SIZE - 1) / QUIZ_PAGE_SIZE : 1; }
+
+int quizPageArg(const QuizSampler& sample) {
+  int page = server.hasArg("page") ? (int)spanNumber(server.argSpan("page")) : 1;
+  int pages = quizPageCount(sample);
+  return page < 1 ? 1 : page > pages ? pages : page;
+}
+
+// The attempt a quiz address or submission names with seed=...; without one
+// the module's questions are asked as written.
+QuizSampler quizSample(const Module& m) {
+  uint32_t seed = QUIZ_SAMPLE_SIZE > 0 ? spanNumber(server.argSpan("seed")) : 0;
+  return QuizSampler(seed, m.quizQuestionCount, QUIZ_SAMPLE_SIZE);
+}
+
+// Seeds fit an IntSlot and are never 0.
+uint32_t newQuizSeed() { return (esp_random() & 0x7FFFFFFF) | 1; }
+
+String quizPageKey(const Module& m, int page) {
+  return "/quiz?module=" + contentParser.str(m.id) + "&page=" + String(page);
+}
+
+// Admission estimates. Every response passes through the connection's
+// output buffer, which holds HTTP_OUTPUT_WINDOW bytes unless its client is
+// slow to take them.
+size_t outputCost(size_t bytes) { return bytes < HTTP_OUTPUT_WINDOW ? bytes : HTTP_OUTPUT_WINDOW; }
+
+// A page built into a String grows in doubling steps, up to twice the page,
+// before it goes to the output buffer. A cached page only needs that buffer.
+size_t pageCost(const String& key, size_t pageBytes) {
+  const CachedResponse* page = pageCache.peek(key);
+  if (page) return outputCost(page->body.length() > page->gzip.length() ? page->body.length() : page->gzip.length());
+  return 2 * pageBytes + outputCost(pageBytes);
+}
+
+size_t rootCost() {
+  return pageCost("/", 512 + contentParser.getModuleCount() * 128);
+}
+
+size_t moduleCost() {
+  const Module* m = contentParser.getModuleById(server.arg("id"));
+  return m ? pageCost("/module?id=" + server.arg("id"), 512 + m->lessonCount * 96) : ADMISSION_DEFAULT_COST;
+}
+
+size_t lessonCost() {
+  const Module* m = contentParser.getModuleById(server.arg("module"));
+  const Lesson* l = m ? contentParser.findLesson(*m, server.arg("lesson").toInt()) : nullptr;
+  if (!l) return ADMISSION_DEFAULT_COST;
+  size_t estimate = l->bodyLength ? l->bodyLength : l->size * 3 / 2;  // As in handleLesson()
+  if (estimate < RESPONSE_CACHE_BYTES) return 2 * estimate + outputCost(estimate);  // Built for the cache
+  return HTML_CHUNK_SIZE + outputCost(estimate);                                    // or streamed
+}
+
+size_t quizCost() {
+  const Module* m = contentParser.getModuleById(server.arg("module"));
+  if (!m) return ADMISSION_DEFAULT_COST;
+  QuizSampler sample = quizSample(*m);
+  int questions = sample.size() < QUIZ_PAGE_SIZE ? sample.size() : QUIZ_PAGE_SIZE;
+  if (sample.getSeed()) return HTML_CHUNK_SIZE + outputCost(512 + questions * 320);  // Streamed, see handleQuiz()
+  return pageCost(quizPageKey(*m, quizPageArg(sample)), 512 + questions * 320);
+}
+
+// Static files are read from flash into the output buffer a window at a time.
+size_t staticCost() {
+  String path = server.uri();
+  const StaticAsset* a = assets.find(TextSpan(path.c_str(), path.length()));
+  return a ? outputCost(a->size) : ADMISSION_DEFAULT_COST;
+}
+
+// Page markup. Slots are filled and escaped by type as the page is written
+// out, so building a page costs no String per fragment. Styles and scripts
+// live in data/app.css and data/app.js.
+HTML_TEMPLATE(PAGE_HEAD, "<html><head><meta name='viewport' content='width=device-width, initial-scale=1'><link rel='stylesheet' href='{}'></head>",
+              AttrSlot);
+HTML_TEMPLATE(ROOT_MODULE, "<div class='mod'><h2>{}</h2><p>Lessons: {}</p><a href='/module?id={}'>Open Module</a></div>",
+              TextSlot, IntSlot, UrlSlot);
+HTML_TEMPLATE(MODULE_HEAD, "<body class='module'><a href='/'>&larr; Back</a><h1>{}</h1>", TextSlot);
+HTML_TEMPLATE(MODULE_LESSON, "<a href='/lesson?module={}&lesson={}'>📄 {}</a>", UrlSlot, IntSlot, TextSlot);
+HTML_TEMPLATE(MODULE_QUIZ, "<hr><a href='/quiz?module={}'>📝 Take Quiz</a>", UrlSlot);
+HTML_TEMPLATE(LESSON_HEAD, "<body class='lesson'><a href='/module?id={}'>&larr; Back</a>", UrlSlot);
+HTML_TEMPLATE(QUIZ_HEAD, "<body class='quiz'><a href='/module?id={}'>&larr; Back</a><h1>{} Quiz</h1>", UrlSlot, TextSlot);
+HTML_TEMPLATE(QUIZ_FORM, "<form id='quizForm' data-module='{}' data-seed='{}' data-total='{}'>", AttrSlot, IntSlot, IntSlot);
+HTML_TEMPLATE(QUIZ_QUESTION, "<div class='q' data-index='{}'><p>{}. {}</p>", IntSlot, IntSlot, TextSlot);
+HTML_TEMPLATE(QUIZ_OPTION, "<label><input type='radio' name='q{}' value='{}'> {}</label><br>", IntSlot, AttrSlot, TextSlot);
+HTML_TEMPLATE(QUIZ_PAGES, "<p class='pages'>Page {} of {}</p>", IntSlot, IntSlot);
+HTML_TEMPLATE(QUIZ_PREV, "<a class='prev' href='/quiz?module={}&seed={}&page={}' onclick='return quizPage(this)'>&larr; Previous</a> ", UrlSlot, IntSlot, IntSlot);
+HTML_TEMPLATE(QUIZ_NEXT, "<a class='next' href='/quiz?module={}&seed={}&page={}' onclick='return quizPage(this)'>Next &rarr;</a>", UrlSlot, IntSlot, IntSlot);
+const char QUIZ_SUBMIT[] = "<button type='button' onclick='gradeQuiz()'>Submit</button>";
+HTML_TEMPLATE(QUIZ_END, "</form><div id='result'></div><script src='{}'></script>", AttrSlot);
+const char PAGE_END[] = "</body></html>";
+
+// Quiz results and statistics (JSON)
+HTML_TEMPLATE(QUIZ_RESULT, "{\"score\":{},\"total\":{},\"marks\":\"", IntSlot, IntSlot);
+HTML_TEMPLATE(QUIZ_STATS_HEAD, "{\"submissions\":{},\"totalScore\":{},\"uncounted\":{},\"questions\":[", IntSlot, IntSlot, IntSlot);
+HTML_TEMPLATE(QUIZ_STATS_QUESTION, "{\"attempts\":{},\"correct\":{},\"picks\":[", IntSlot, IntSlot);
+HTML_TEMPLATE(QUIZ_STATS_PICK, "{}", IntSlot);
 
 void handleRoot() {
-  String html = "<html><head><meta name='viewport' content='width=device-width, initial-scale=1'><style>body{font-family:sans-serif;padding:20px;}.mod{background:#eee;padding:15px;margin-bottom:10px;border-radius:5px;}</style></head><body><h1>Available Modules</h1>";
-  
-  if (contentParser.getModuleCount() == 0) {
-      html += "<p>No modules loaded. Check filesystem.</p>";
-  }
+  const CachedResponse* page = cachedPage("/");
+  if (page) { sendCachedPage(*page); return; }
 
-  for (int i = 0; i < contentParser.getModuleCount(); i++) {
-    Module* m = contentParser.getModule(i);
-    html += "<div class='mod'><h2>" + m->name + "</h2>";
-    html += "<p>Lessons: " + String(m->lessonCount) + "</p>";
-    html += "<a href='/module?id=" + m->id + "'>Open Module</a></div>";
+  int count = contentParser.getModuleCount();
+  String html;
+  html.reserve(512 + count * 128);
+  ChunkedWriter out(appendChunk, &html);
+  renderHtml(out, PAGE_HEAD, assets.url(ASSET_CSS));
+  out.write("<body class='home'><h1>Available Modules</h1>");
+  if (count == 0) out.write("<p>No modules loaded. Check filesystem.</p>");
+  for (int i = 0; i < count; i++) {
+    const Module* m = contentParser.getModule(i);
+    renderHtml(out, ROOT_MODULE, m->name, m->lessonCount, m->id);
   }
-  html += "</body></html>";
-  server.send(200, "text/html", html);
+  out.write(PAGE_END);
+  out.flush();
+  sendPage("/", html);
 }
 
 void handleModule() {
   if (!server.hasArg("id")) { server.send(400, "text/plain", "Missing ID"); return; }
-  Module* m = contentParser.getModuleById(server.arg("id"));
+  String key = "/module?id=" + server.arg("id");
+  const CachedResponse* page = cachedPage(key);
+  if (page) { sendCachedPage(*page); return; }
+
+  const Module* m = contentParser.getModuleById(server.arg("id"));
   if (!m) { server.send(404, "text/plain", "Module Not Found"); return; }
 
-  String html = "<html><head><meta name='viewport' content='width=device-width, initial-scale=1'><style>body{font-family:sans-serif;padding:20px;} a{display:block;margin:10px 0;font-size:18px;}</style></head><body>";
-  html += "<a href='/'>&larr; Back</a><h1>" + m->name + "</h1>";
-  
-  for(int i=0; i<m->lessonCount; i++) {
-      html += "<a href='/lesson?module=" + m->id + "&lesson=" + String(m->lessons[i].id) + "'>📄 " + m->lessons[i].title + "</a>";
+  String html;
+  html.reserve(512 + m->lessonCount * 96);
+  ChunkedWriter out(appendChunk, &html);
+  renderHtml(out, PAGE_HEAD, assets.url(ASSET_CSS));
+  renderHtml(out, MODULE_HEAD, m->name);
+  for (int i = 0; i < m->lessonCount; i++) {
+    const Lesson& l = contentParser.getLesson(*m, i);
+    renderHtml(out, MODULE_LESSON, m->id, l.id, l.title);
   }
-  if(m->hasQuiz) html += "<hr><a href='/quiz?module=" + m->id + "'>📝 Take Quiz</a>";
-  
-  html += "</body></html>";
-  server.send(200, "text/html", html);
+  if (m->hasQuiz()) renderHtml(out, MODULE_QUIZ, m->id);
+  out.write(PAGE_END);
+  out.flush();
+  sendPage(key, html);
+}
+
+void writeLessonPage(const Module& m, const Lesson& l, ChunkedWriter& out) {
+  renderHtml(out, PAGE_HEAD, assets.url(ASSET_CSS));
+  renderHtml(out, LESSON_HEAD, m.id);
+  contentParser.writeLessonHtml(m, l, out);
+  out.write(PAGE_END);
 }
 
 void handleLesson() {
   if (!server.hasArg("module") || !server.hasArg("lesson")) { server.send(400, "text/plain", "Bad Request"); return; }
-  Module* m = contentParser.getModuleById(server.arg("module"));
-  if (!m) return;
+  const Module* m = contentParser.getModuleById(server.argSpan("module"));
+  if (!m) { server.send(404, "text/plain", "Module Not Found"); return; }
   
-  int lid = server.arg("lesson").toInt();
-  for(int i=0; i<m->lessonCount; i++) {
-      if(m->lessons[i].id == lid) {
-          String html = "<html><head><meta name='viewport' content='width=device-width, initial-scale=1'><style>body{font-family:sans-serif;padding:20px;line-height:1.6;}</style></head><body>";
-          html += "<a href='/module?id=" + m->id + "'>&larr; Back</a>";
-          html += m->lessons[i].content; // Already HTML
-          html += "</body></html>";
-          server.send(200, "text/html", html);
-          return;
-      }
+  const Lesson* l = contentParser.findLesson(*m, (int)spanNumber(server.argSpan("lesson")));
+  if (!l) { server.send(404, "text/plain", "Lesson not found"); return; }
+
+  // Lessons that fit the page cache are rendered once more into a String and
+  // kept gzip-compressed for clients that accept it
+  const CachedResponse* page = nullptr;
+  size_t estimate = l->bodyLength ? l->bodyLength : l->size * 3 / 2;  // HTML runs ~1.4x the Markdown
+  if (acceptsGzip() && estimate < RESPONSE_CACHE_BYTES) {
+    String key = "/lesson?module=" + contentParser.str(m->id) + "&lesson=" + String(l->id);
+    page = cachedPage(key);
+    if (!page) {
+      String html;
+      ChunkedWriter out(appendChunk, &html);
+      writeLessonPage(*m, *l, out);
+      out.flush();
+      page = pageCache.put(key, html, false);
+    }
+    if (page && page->gzip.length() == 0) page = nullptr;
+  }
+  if (sendNotModified(contentHash(m->id.ptr, m->id.len, buildTag ^ assets.getVersion() ^ l->hash), page != nullptr)) return;
+  if (page) { sendGzipBody(*page); return; }
+
+  // Pack bodies are HTML already: read from flash as the client takes them,
+  // after a head rendered here and before the closing tags
+  if (l->bodyLength > 0) {
+    String head;
+    ChunkedWriter out(appendChunk, &head);
+    renderHtml(out, PAGE_HEAD, assets.url(ASSET_CSS));
+    renderHtml(out, LESSON_HEAD, m->id);
+    out.flush();
+    HttpBodySource body;
+    if (FileBody::open(CONTENT_PACK_PATH, l->bodyOffset, l->bodyLength, PAGE_END, body)) {
+      server.sendBody(200, "text/html", body, head.c_str(), head.length());
+      return;
+    }
+  }
+
+  // Stream with chunked encoding; memory stays at one chunk buffer
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/html", "");
+  ChunkedWriter out(sendChunk, nullptr);
+  writeLessonPage(*m, *l, out);
+  out.finish();
+}
+
+// One page of an attempt. Answers from other pages are kept by app.js in
+// the address after '#', so the board keeps nothing between pages, and a
+// page costs the same however big the question bank is. Questions are
+// numbered by their place in the attempt; option letters are as shown.
+void writeQuizPage(const Module& m, const QuizSampler& sample, int page, ChunkedWriter& out) {
+  int pages = quizPageCount(sample);
+  int first = (page - 1) * QUIZ_PAGE_SIZE;
+  int end = first + QUIZ_PAGE_SIZE < (int)sample.size() ? first + QUIZ_PAGE_SIZE : (int)sample.size();
+  int seed = (int)sample.getSeed();
+  renderHtml(out, QUIZ_FORM, m.id, seed, sample.size());
+  if (pages > 1) renderHtml(out, QUIZ_PAGES, page, pages);
+  QuizText text;
+  for (int i = first; i < end; i++) {
+    if (!contentParser.readQuestion(contentParser.getQuestion(m, sample.question(i)), text)) continue;
+    const QuizQuestionSpans& q = text.spans;
+    uint8_t order[QUIZ_OPTION_LETTERS];
+    sample.options(i, q.optionCount, order);
+    renderHtml(out, QUIZ_QUESTION, i, i + 1, q.question);
+    for (int j = 0; j < q.optionCount; j++) {
+      char letter = 'a' + j;
+      renderHtml(out, QUIZ_OPTION, i, TextSpan(&letter, 1), q.option(order[j]));
+    }
+    out.write("</div>");
   }
-  server.send(404, "text/plain", "Lesson not found");
+  if (page > 1) renderHtml(out, QUIZ_PREV, m.id, seed, page - 1);
+  if (page < pages) renderHtml(out, QUIZ_NEXT, m.id, seed, page + 1);
+  else out.write(QUIZ_SUBMIT);
+  renderHtml(out, QUIZ_END, assets.url(ASSET_JS));
 }
 
 void handleQuiz() {
-  if (!server.hasArg("module")) return;
-  Module* m = contentParser.getModuleById(server.arg("module"));
-  if (m) {
-      String html = "<html><head><meta name='viewport' content='width=device-width, initial-scale=1'><style>body{font-family:sans-serif;padding:20px;}.q{margin-bottom:20px;background:#f9f9f9;padding:10px;}</style></head><body>";
-      html += "<a href='/module?id=" + m->id + "'>&larr; Back</a><h1>" + m->name + " Quiz</h1>";
-      html += contentParser.generateQuizHtml(*m);
-      html += "</body></html>";
-      server.send(200, "text/html", html);
+  if (!server.hasArg("module")) { server.send(400, "text/plain", "Bad Request"); return; }
+  const Module* m = contentParser.getModuleById(server.argSpan("module"));
+  if (!m) { server.send(404, "text/plain", "Module Not Found"); return; }
+  QuizSampler sample = quizSample(*m);
+  if (QUIZ_SAMPLE_SIZE > 0 && m->hasQuiz() && !sample.getSeed()) {
+    // A new attempt. Its seed goes in the address, so reloading or paging
+    // shows the same questions
+    server.sendHeader("Location", "/quiz?module=" + contentParser.str(m->id) + "&seed=" + String(newQuizSeed()));
+    server.send(302, "text/plain", "Redirect");
+    return;
   }
+  int pageNumber = quizPageArg(sample);
+
+  if (sample.getSeed()) {
+    // Every attempt differs, so these are streamed rather than cached
+    server.sendHeader("Cache-Control", "no-store");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/html", "");
+    ChunkedWriter out(sendChunk, nullptr);
+    renderHtml(out, PAGE_HEAD, assets.url(ASSET_CSS));
+    renderHtml(out, QUIZ_HEAD, m->id, m->name);
+    writeQuizPage(*m, sample, pageNumber, out);
+    out.write(PAGE_END);
+    out.finish();
+    return;
+  }
+
+  String key = quizPageKey(*m, pageNumber);
+  const CachedResponse* page = cachedPage(key);
+  if (page) { sendCachedPage(*page); return; }
+
+  String html;
+  html.reserve(512 + (sample.size() < QUIZ_PAGE_SIZE ? sample.size() : QUIZ_PAGE_SIZE) * 320);
+  ChunkedWriter out(appendChunk, &html);
+  renderHtml(out, PAGE_HEAD, assets.url(ASSET_CSS));
+  renderHtml(out, QUIZ_HEAD, m->id, m->name);
+  if (m->hasQuiz()) writeQuizPage(*m, sample, pageNumber, out);
+  out.write(PAGE_END);
+  out.flush();
+  sendPage(key, html);
+}
+
+// Grades a quiz on the board, so the answer key never reaches the page, and
+// adds it to the module's statistics. The page posts module=<id>&seed=<the
+// attempt's>&answers=<one letter per question as shown, '-' if skipped>; the
+// reply has the score and a mark per question: 1 right, 0 wrong, - skipped.
+// Statistics count each answer against the question and option of the file.
+char quizMark(const QuizQuestion& q, int option) {
+  if (option < 0) return '-';
+  return 'a' + option == q.correctAnswer ? '1' : '0';
+}
+
+// The option of the file picked for the question at position i, or -1.
+int quizPick(const QuizSampler& sample, const QuizQuestion& q, TextSpan answers, int i) {
+  return i < (int)answers.len ? sample.pick(i, q.optionCount, answers.ptr[i]) : -1;
+}
+
+// Option count of each question of m's bank, as QuizStatsTable asks for it.
+struct QuizOptionCounts {
+  const Module* m;
+  int operator()(uint16_t i) const { return contentParser.getQuestion(*m, i).optionCount; }
+};
+
+void handleQuizSubmit() {
+  const Module* m = contentParser.getModuleById(server.argSpan("module"));
+  if (!m || !m->hasQuiz()) { server.send(404, "text/plain", "Quiz not found"); return; }
+  QuizSampler sample = quizSample(*m);
+  TextSpan answers = server.argSpan("answers");
+  if (answers.len > sample.size()) { server.send(400, "text/plain", "Too many answers"); return; }
+
+  // Without memory for the counters the answers are still graded
+  QuizStats* stats = quizStats.open(quizStatsKey(m->id, m->quizHash, m->quizQuestionCount), m->quizQuestionCount,
+                                    QuizOptionCounts{m});
+  int score = 0;
+  for (int i = 0; i < (int)answers.len; i++) {
+    uint32_t index = sample.question(i);
+    const QuizQuestion& q = contentParser.getQuestion(*m, index);
+    int option = quizPick(sample, q, answers, i);
+    char mark = quizMark(q, option);
+    if (stats && mark != '-') QuizStatsTable::record(*stats, index, option, mark == '1');
+    score += mark == '1';
+  }
+  if (stats) {
+    stats->submissions++;
+    stats->score += score;
+  }
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  ChunkedWriter out(sendChunk, nullptr);
+  renderHtml(out, QUIZ_RESULT, score, sample.size());
+  for (int i = 0; i < (int)sample.size(); i++) {
+    const QuizQuestion& q = contentParser.getQuestion(*m, sample.question(i));
+    char mark = quizMark(q, quizPick(sample, q, answers, i));
+    out.write(&mark, 1);
+  }
+  out.write("\"}");
+  out.finish();
+}
+
+// What a class answered: per question of the bank the attempts, right
+// answers and how often each option was picked, since the quiz last
+// changed. Questions past the counters' budget are listed as uncounted.
+void handleQuizStats() {
+  const Module* m = contentParser.getModuleById(server.argSpan("module"));
+  if (!m || !m->hasQuiz()) { server.send(404, "text/plain", "Quiz not found"); return; }
+  const QuizStats* stats = quizStats.find(quizStatsKey(m->id, m->quizHash, m->quizQuestionCount));
+  size_t words;
+  int tracked = stats ? stats->questionCount : QuizStatsTable::countable(m->quizQuestionCount, QuizOptionCounts{m}, words);
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  ChunkedWriter out(sendChunk, nullptr);
+  renderHtml(out, QUIZ_STATS_HEAD, stats ? stats->submissions : 0, stats ? stats->score : 0, m->quizQuestionCount - tracked);
+  for (int i = 0; i < tracked; i++) {
+    int options = stats ? stats->optionCount(i) : contentParser.getQuestion(*m, i).optionCount;
+    const uint32_t* picks = stats ? stats->picks(i) : nullptr;
+    uint32_t attempts = 0;
+    for (int j = 0; picks && j < options; j++) attempts += picks[j];
+    if (i) out.write(",");
+    renderHtml(out, QUIZ_STATS_QUESTION, attempts, stats ? stats->correct(i) : 0);
+    for (int j = 0; j < options; j++) {
+      if (j) out.write(",");
+      renderHtml(out, QUIZ_STATS_PICK, picks ? picks[j] : 0);
+    }
+    out.write("]}");
+  }
+  out.write("]}");
+  out.finish();
+}
+
+// Serves /static/app.<hash>.css and .js. The hash pins the bytes, so clients
+// may cache them for a year without asking again.
+// Outdated hashes get 404 rather than the captive-portal redirect, which
+// would hand the browser a page in place of a stylesheet.
+bool handleStatic() {
+  String path = server.uri();
+  if (!path.startsWith(STATIC_URL_PREFIX)) return false;
+  const StaticAsset* a = assets.find(TextSpan(path.c_str(), path.length()));
+  if (!a) { server.send(404, "text/plain", "Not Found"); return true; }
+  HttpBodySource body;
+  if (!FileBody::open(a->path, 0, a->size, "", body)) { server.send(500, "text/plain", "Cannot read file"); return true; }
+  server.sendHeader("Cache-Control", "public, max-age=31536000, immutable");
+  server.sendBody(200, a->type, body);
+  return true;
+}
+
+// Picks up edited content and asset files. Cached pages link the assets by
+// hash, so new asset hashes drop them even when the content is unchanged or
+// fails to reload.
+ReloadStats reloadContent() {
+  uint32_t assetVersion = assets.getVersion();
+  assets.load();
+  if (assets.getVersion() != assetVersion) pageCache.clear();
+  return contentParser.reloadModules();
+}
+
+// Re-reads changed content files. POST only, so link prefetchers and
+// crawlers on the hotspot cannot trigger it.
+void handleAdminReload() {
+  ReloadStats r = reloadContent();
+  String msg = r.full ? "Reloaded content pack" : "Reparsed " + String(r.reparsed) + " of " + String(r.files) + " files (" +
+               String(r.added) + " added, " + String(r.changed) + " changed, " + String(r.removed) + " removed)";
+  server.send(200, "text/plain", msg + " in " + String(r.millis) + " ms\n");
+}
+
+// Connection, cache and admission counters, to see how a deployment copes
+// with a full class: requests shed and why, peak queue and heap, and how
+// many requests were connectivity checks.
+void handleDebugServer() {
+  const HttpEngineStats& h = server.getStats();
+  const ResponseCacheStats& c = pageCache.getStats();
+  const AdmissionStats& a = admission.getStats();
+  const LessonCacheStats& l = contentParser.getLessonCacheStats();
+  char json[800];
+  snprintf(json, sizeof(json),
+           "{\"http\":{\"accepted\":%u,\"served\":%u,\"reused\":%u,\"timedOut\":%u,\"rejected\":%u,\"aborted\":%u,\"overflows\":%u,"
+           "\"active\":%u,\"peakActive\":%u},"
+           "\"cache\":{\"hits\":%u,\"misses\":%u,\"evictions\":%u,\"notModified\":%u,\"bytes\":%u},"
+           "\"lessons\":{\"hits\":%u,\"misses\":%u,\"evictions\":%u,\"bytes\":%u,\"peakBytes\":%u},"
+           "\"admission\":{\"admitted\":%u,\"shedQueue\":%u,\"shedBytes\":%u,\"shedHeap\":%u,\"peakQueued\":%u,"
+           "\"peakQueuedBytes\":%u,\"largestCost\":%u},"
+           "\"heap\":{\"free\":%u,\"largestBlock\":%u},\"probes\":{",
+           (unsigned)h.accepted, (unsigned)h.served, (unsigned)h.reused, (unsigned)h.timedOut, (unsigned)h.rejected,
+           (unsigned)h.aborted, (unsigned)h.overflows, (unsigned)h.active, (unsigned)h.peakActive, (unsigned)c.hits, (unsigned)c.misses, (unsigned)c.evictions,
+           (unsigned)c.notModified, (unsigned)c.bytes, (unsigned)l.hits, (unsigned)l.misses, (unsigned)l.evictions,
+           (unsigned)l.bytes, (unsigned)l.peakBytes, (unsigned)a.admitted, (unsigned)a.shedQueue, (unsigned)a.shedBytes,
+           (unsigned)a.shedHeap, (unsigned)a.peakQueued, (unsigned)a.peakQueuedBytes, (unsigned)a.largestCost,
+           (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMaxAllocHeap());
+  String body = json;
+  for (int i = 0; i < probes.size(); i++) {
+    const CaptiveProbe& p = probes.get(i);
+    snprintf(json, sizeof(json), "%s\"%s\":%u", i ? "," : "", p.path, (unsigned)p.hits);
+    body += json;
+  }
+  body += "}}";
+  server.send(200, "application/json", body);
+}
+
+// Where boot time and heap went, per load phase and per content file.
+void handleDebugBoot() {
+  String json;
+  contentParser.getBootProfile().appendJson(json);
+  server.send(200, "application/json", json);
+}
+
+// Work for the task that owns the content and the page cache. The serial
+// console runs on loop() and hands commands over through this queue.
+enum ServerCommand : uint8_t { COMMAND_RELOAD };
+SpscQueue<uint8_t, 4> serverCommands;
+bool dnsOnTask = false;
+bool httpOnTask = false;
+
+void runServerCommands() {
+  uint8_t cmd;
+  while (serverCommands.pop(cmd)) {
+    if (cmd == COMMAND_RELOAD) reloadContent();
+  }
+}
+
+// Serial console: "reload" does the same as POST /admin/reload.
+void handleSerialCommand() {
+  if (!Serial.available()) return;
+  String cmd = Serial.readStringUntil('\n');
+  cmd.trim();
+  if (cmd == "reload") { if (!serverCommands.push(COMMAND_RELOAD)) Serial.println("Reload already queued"); }
+  else if (cmd.length() > 0) Serial.println("Unknown command: " + cmd);
+}
+
+void dnsTask(void*) {
+  dnsServer.processNextRequest();
+  taskSleep(DNS_TASK_POLL_MS);
+}
+
+void httpTask(void*) {
+  runServerCommands();
+  server.handleClient(HTTP_TASK_POLL_MS);
 }
 
 void setup() {
@@ -84,6 +616,7 @@ void setup() {
     contentParser.loadModules();
     contentParser.printModuleInfo(0);
   }
+  assets.load();
 
   WiFi.mode(WIFI_AP);
   WiFi.softAP(ssid, password);
@@ -91,20 +624,38 @@ void setup() {
   dnsServer.setErrorReplyCode(DNSReplyCode::NoError);
   dnsServer.start(DNS_PORT, "*", WiFi.softAPIP());
 
-  server.on("/", handleRoot);
-  server.on("/module", handleModule);
-  server.on("/lesson", handleLesson);
-  server.on("/quiz", handleQuiz);
+  const char* requestHeaders[] = { "If-None-Match", "Accept-Encoding" };
+  server.collectHeaders(requestHeaders, 2);
+  server.on("/", handleRoot, rootCost);
+  server.on("/module", handleModule, moduleCost);
+  server.on("/lesson", handleLesson, lessonCost);
+  server.on("/quiz", handleQuiz, quizCost);
+  server.on("/quiz/submit", METHOD_POST, handleQuizSubmit);
+  server.on("/quiz/stats", handleQuizStats);
+  server.on("/admin/reload", METHOD_POST, handleAdminReload);
+  server.on("/debug/boot", handleDebugBoot);
+  server.on("/debug/server", handleDebugServer);
   server.onNotFound([](){
+      if (handleStatic()) return;
       server.sendHeader("Location", "/");
       server.send(302, "text/plain", "Redirect");
-  });
+  }, staticCost);
+  server.setAdmission(&admission);
+  server.setProbes(&probes);
 
   server.begin();
+  // Without a task of its own (out of memory) a server runs on loop() as before
+#if SERVER_TASKS
+  dnsOnTask = startTask("dns", dnsTask, nullptr, DNS_TASK_CORE, DNS_TASK_STACK, 2);
+  httpOnTask = startTask("http", httpTask, nullptr, HTTP_TASK_CORE, HTTP_TASK_STACK, 1);
+  if (!dnsOnTask || !httpOnTask) Serial.println("Could not start server tasks; serving from loop()");
+#endif
   Serial.println("Ready!");
 }
 
 void loop() {
-  dnsServer.processNextRequest();
-  server.handleClient();
+  if (!dnsOnTask) dnsServer.processNextRequest();
+  if (!httpOnTask) { runServerCommands(); server.handleClient(); }
+  handleSerialCommand();
+  if (dnsOnTask && httpOnTask) taskSleep(10);  // Leave the core to the HTTP task
 }
\ No newline at end of file
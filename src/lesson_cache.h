@@ -0,0 +1,103 @@
+#ifndef LESSON_CACHE_H
+#define LESSON_CACHE_H
+
+#include <Arduino.h>
+#include <utility>
+
+// Byte budget for rendered lesson HTML kept in RAM. Override with
+// -DLESSON_CACHE_BYTES=... in build_flags.
+#ifndef LESSON_CACHE_BYTES
+#define LESSON_CACHE_BYTES 16384
+#endif
+#define LESSON_CACHE_SLOTS 8
+
+struct LessonCacheStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+  size_t bytes;      // HTML bytes currently cached
+  size_t peakBytes;  // High-water mark of bytes
+};
+
+// Least-recently-used cache of rendered lessons, bounded by total HTML bytes.
+// Slots are few, so the LRU victim is found by scanning use ticks.
+class LessonCache {
+private:
+  struct Slot {
+    uint32_t key;
+    uint32_t lastUse;  // 0 = empty
+    String html;
+  };
+
+  Slot slots[LESSON_CACHE_SLOTS];
+  size_t budget;
+  uint32_t tick;
+  LessonCacheStats stats;
+
+  // Assigning String() would keep the old buffer; a null string frees it.
+  static void release(String& s) { s = (const char*)nullptr; }
+
+  void evict(Slot& s) {
+    stats.bytes -= s.html.length();
+    stats.evictions++;
+    release(s.html);
+    s.lastUse = 0;
+  }
+
+public:
+  LessonCache(size_t byteBudget = LESSON_CACHE_BYTES) : budget(byteBudget), tick(0) {
+    memset(&stats, 0, sizeof(stats));
+    for (int i = 0; i < LESSON_CACHE_SLOTS; i++) slots[i].lastUse = 0;
+  }
+
+  // Counts a hit or a miss; on a hit the entry becomes most recently used.
+  const String* get(uint32_t key) {
+    for (int i = 0; i < LESSON_CACHE_SLOTS; i++) {
+      if (slots[i].lastUse && slots[i].key == key) {
+        slots[i].lastUse = ++tick;
+        stats.hits++;
+        return &slots[i].html;
+      }
+    }
+    stats.misses++;
+    return nullptr;
+  }
+
+  // Takes ownership of html, evicting least recently used entries until it
+  // fits. Returns nullptr (and leaves html untouched) if it exceeds the budget.
+  const String* put(uint32_t key, String& html) {
+    if (html.length() > budget) return nullptr;
+    Slot* target = nullptr;
+    while (true) {
+      Slot* lru = nullptr;
+      Slot* empty = nullptr;
+      for (int i = 0; i < LESSON_CACHE_SLOTS; i++) {
+        Slot& s = slots[i];
+        if (!s.lastUse) { if (!empty) empty = &s; }
+        else if (!lru || s.lastUse < lru->lastUse) lru = &s;
+      }
+      if (empty && stats.bytes + html.length() <= budget) { target = empty; break; }
+      if (!lru) return nullptr;
+      evict(*lru);
+    }
+    target->key = key;
+    target->lastUse = ++tick;
+    target->html = std::move(html);
+    stats.bytes += target->html.length();
+    if (stats.bytes > stats.peakBytes) stats.peakBytes = stats.bytes;
+    return &target->html;
+  }
+
+  void clear() {
+    for (int i = 0; i < LESSON_CACHE_SLOTS; i++) {
+      release(slots[i].html);
+      slots[i].lastUse = 0;
+    }
+    stats.bytes = 0;
+  }
+
+  const LessonCacheStats& getStats() const { return stats; }
+  size_t getBudget() const { return budget; }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef QUIZ_SAMPLER_H
+#define QUIZ_SAMPLER_H
+
+// Draws one attempt at a quiz from a module's question bank: which questions
+// are asked, in what order, and in what order each shows its options. All
+// of it follows from a seed, so the board keeps nothing per student: the
+// seed travels in the quiz address and the submitted answers, and grading
+// draws the same attempt again. Nothing is copied or shuffled in memory;
+// the i-th question and its option order are computed on demand, O(1) each,
+// so showing K questions of a bank of any size costs O(K).
+
+#include <stddef.h>
+#include <stdint.h>
+#include "content_format.h"
+
+// Questions per attempt; a bank with fewer is asked whole, in a shuffled
+// order. 0 asks every question in file order, as written. Override with
+// -DQUIZ_SAMPLE_SIZE=... in build_flags.
+#ifndef QUIZ_SAMPLE_SIZE
+#define QUIZ_SAMPLE_SIZE 20
+#endif
+
+// A 32-bit integer hash with good avalanche, used as the PRNG step.
+inline uint32_t quizMix(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+class QuizSampler {
+private:
+  uint32_t seed;  // 0 = the bank as written
+  uint32_t bank;
+  uint32_t count;
+  uint32_t halfBits;
+
+  // A Feistel network over 2 * halfBits bits, keyed by the seed: a
+  // bijection, so distinct positions always give distinct questions.
+  uint32_t permute(uint32_t x) const {
+    uint32_t mask = (1u << halfBits) - 1;
+    uint32_t left = x >> halfBits, right = x & mask;
+    for (uint32_t round = 0; round < 4; round++) {
+      uint32_t next = left ^ (quizMix(right ^ seed ^ round * 0x9e3779b9u) & mask);
+      left = right;
+      right = next;
+    }
+    return left << halfBits | right;
+  }
+
+public:
+  QuizSampler(uint32_t attemptSeed, uint32_t bankSize, uint32_t sampleSize)
+      : seed(attemptSeed), bank(bankSize), count(bankSize), halfBits(1) {
+    if (seed && sampleSize < bankSize) count = sampleSize;
+    while ((1u << (2 * halfBits)) < bank) halfBits++;
+  }
+
+  uint32_t size() const { return count; }
+  uint32_t getSeed() const { return seed; }
+
+  // Bank index of the question asked at position (0-based, below size()).
+  // Values past the bank are walked on through the permutation until one
+  // lands inside it: under 4 steps on average, as the network's range is
+  // less than four times the bank.
+  uint32_t question(uint32_t position) const {
+    if (!seed) return position;
+    uint32_t x = position;
+    do x = permute(x); while (x >= bank);
+    return x;
+  }
+
+  // Fills order[shown] with the option (0-based, as in the quiz file) shown
+  // in that place for the question at position.
+  void options(uint32_t position, int optionCount, uint8_t* order) const {
+    for (int i = 0; i < optionCount; i++) order[i] = (uint8_t)i;
+    if (!seed) return;
+    uint32_t r = quizMix(seed ^ quizMix(position + 1));
+    for (int i = optionCount - 1; i > 0; i--) {
+      r = quizMix(r + 0x9e3779b9u);
+      int j = (int)(r % (uint32_t)(i + 1));
+      uint8_t t = order[i];
+      order[i] = order[j];
+      order[j] = t;
+    }
+  }
+
+  // The option of the file (0-based) a student picked by answering shown,
+  // the letter from a) in the order they saw, for the question at position;
+  // -1 for a skipped or impossible answer. Grading counts it against the
+  // bank question at question(position).
+  int pick(uint32_t position, int optionCount, char shown) const {
+    int place = shown - 'a';
+    if (place < 0 || place >= optionCount) return -1;
+    uint8_t order[QUIZ_OPTION_LETTERS];
+    options(position, optionCount, order);
+    return order[place];
+  }
+};
+
+#endif
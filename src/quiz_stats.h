@@ -0,0 +1,142 @@
+#ifndef QUIZ_STATS_H
+#define QUIZ_STATS_H
+
+// Running totals of graded quiz submissions, for the teacher: per module
+// the number of submissions, per question of the bank how often each option
+// was picked and how often the answer was right. A module's counters are
+// one block, allocated at its first submission and sized to its bank and
+// the questions' option counts; a submission costs O(questions asked).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "content_format.h"
+
+// Modules tracked at once, and heap for all their counters: a question
+// costs 4 bytes per option plus 8. Modules submitted to least recently make
+// room for a new one; a bank too large for the whole budget is counted up
+// to the question that fills it, and the rest reported as uncounted.
+// Override with -D... in build_flags.
+#ifndef QUIZ_STATS_MODULES
+#define QUIZ_STATS_MODULES 8
+#endif
+#ifndef QUIZ_STATS_BYTES
+#define QUIZ_STATS_BYTES 16384
+#endif
+
+struct QuizStats {
+  uint32_t key;      // quizStatsKey() of the module's quiz; 0 = empty
+  uint32_t lastUse;
+  uint32_t submissions;
+  uint32_t score;    // Correct answers over all submissions
+  uint16_t questionCount;  // Questions counted, from the start of the bank
+  // questionCount + 1 offsets into counts, then per question the right
+  // answers followed by the picks of each option
+  uint32_t* counts;
+
+  int optionCount(int question) const { return (int)(counts[question + 1] - counts[question]) - 1; }
+  uint32_t correct(int question) const { return counts[counts[question]]; }
+  const uint32_t* picks(int question) const { return counts + counts[question] + 1; }
+};
+
+// Identifies one version of a module's quiz: an edited quiz starts over.
+inline uint32_t quizStatsKey(TextSpan moduleId, uint32_t quizHash, uint32_t questionCount) {
+  uint32_t key = contentHash(moduleId.ptr, moduleId.len, quizHash ^ questionCount);
+  return key ? key : 1;
+}
+
+class QuizStatsTable {
+private:
+  QuizStats slots[QUIZ_STATS_MODULES];
+  uint32_t tick;
+  uint32_t evictions;
+  size_t bytes;  // Counters of all modules
+
+  void release(QuizStats& s) {
+    if (s.counts) bytes -= s.counts[s.questionCount] * sizeof(uint32_t);
+    free(s.counts);
+    memset(&s, 0, sizeof(s));
+  }
+
+public:
+  QuizStatsTable() : tick(0), evictions(0), bytes(0) { memset(slots, 0, sizeof(slots)); }
+  ~QuizStatsTable() {
+    for (int i = 0; i < QUIZ_STATS_MODULES; i++) free(slots[i].counts);
+  }
+  QuizStatsTable(const QuizStatsTable&) = delete;
+  QuizStatsTable& operator=(const QuizStatsTable&) = delete;
+
+  const QuizStats* find(uint32_t key) const {
+    for (int i = 0; i < QUIZ_STATS_MODULES; i++) {
+      if (slots[i].key == key) return &slots[i];
+    }
+    return nullptr;
+  }
+
+  // How many questions from the start of a bank of questionCount fit the
+  // budget; words receives the size of their counters.
+  template <typename OptionCount>
+  static uint16_t countable(uint16_t questionCount, OptionCount optionCount, size_t& words) {
+    uint16_t n = 0;
+    words = 1;
+    while (n < questionCount && (words + 2 + optionCount(n)) * sizeof(uint32_t) <= QUIZ_STATS_BYTES) {
+      words += 2 + optionCount(n);
+      n++;
+    }
+    return n;
+  }
+
+  // The entry for key, started empty if there is none; optionCount(i) gives
+  // the options of question i of the bank. nullptr when out of memory.
+  template <typename OptionCount>
+  QuizStats* open(uint32_t key, uint16_t questionCount, OptionCount optionCount) {
+    for (int i = 0; i < QUIZ_STATS_MODULES; i++) {
+      if (slots[i].key == key) { slots[i].lastUse = ++tick; return &slots[i]; }
+    }
+    size_t words;
+    uint16_t tracked = countable(questionCount, optionCount, words);
+    QuizStats* target;
+    while (true) {
+      QuizStats* empty = nullptr;
+      QuizStats* lru = nullptr;
+      for (int i = 0; i < QUIZ_STATS_MODULES; i++) {
+        QuizStats& s = slots[i];
+        if (!s.key) { if (!empty) empty = &s; }
+        else if (!lru || s.lastUse < lru->lastUse) lru = &s;
+      }
+      if (empty && bytes + words * sizeof(uint32_t) <= QUIZ_STATS_BYTES) { target = empty; break; }
+      evictions++;
+      release(*lru);  // Never null: the budget holds words on its own
+    }
+
+    uint32_t* counts = (uint32_t*)calloc(words, sizeof(uint32_t));
+    if (!counts) return nullptr;
+    uint32_t next = tracked + 1;
+    for (uint16_t i = 0; i < tracked; i++) {
+      counts[i] = next;
+      next += 1 + optionCount(i);
+    }
+    counts[tracked] = next;
+
+    target->key = key;
+    target->questionCount = tracked;
+    target->counts = counts;
+    target->lastUse = ++tick;
+    bytes += words * sizeof(uint32_t);
+    return target;
+  }
+
+  // Counts one answer; option is 0-based.
+  static void record(QuizStats& s, int question, int option, bool correct) {
+    if (question >= s.questionCount || option < 0 || option >= s.optionCount(question)) return;
+    uint32_t* q = s.counts + s.counts[question];
+    q[1 + option]++;
+    if (correct) q[0]++;
+  }
+
+  uint32_t getEvictions() const { return evictions; }
+  size_t getBytes() const { return bytes; }
+};
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <Arduino.h>
+#include <new>
+#include <utility>
+#include "content_format.h"
+#include "gzip_writer.h"
+#include "http_engine.h"
+
+// Byte budget for finished pages kept in RAM. Override with
+// -DRESPONSE_CACHE_BYTES=... in build_flags.
+#ifndef RESPONSE_CACHE_BYTES
+#define RESPONSE_CACHE_BYTES 12288
+#endif
+#define RESPONSE_CACHE_SLOTS 8
+
+struct ResponseCacheStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+  uint32_t notModified;  // Requests answered with 304
+  size_t bytes;
+};
+
+// A finished page, compressed once when it is stored, and the ETag it is
+// served with.
+struct CachedResponse {
+  String key;        // Route and arguments, e.g. "/module?id=math"
+  String body;       // Empty if only the gzip copy was kept
+  String gzip;       // Empty if compression failed or did not help
+  uint32_t etag;     // contentHash() of the uncompressed page
+  uint32_t lastUse;  // 0 = empty, or dropped but still being sent
+  uint8_t readers;   // Responses still sending this entry; it stays until they finish
+};
+
+// Least-recently-used cache of generated pages keyed by route and arguments.
+// Entries belong to one content generation: sync() drops them all when the
+// content is reloaded. Same slot scheme as LessonCache. An entry being sent
+// with openBody() is neither evicted nor freed until its responses finish;
+// until then it still counts against the budget.
+class ResponseCache {
+private:
+  CachedResponse slots[RESPONSE_CACHE_SLOTS];
+  size_t budget;
+  uint32_t tick;
+  uint32_t generation;
+  ResponseCacheStats stats;
+
+  static size_t entryBytes(const CachedResponse& s) { return s.key.length() + s.body.length() + s.gzip.length(); }
+
+  // Frees the slot's strings; assigning String() would keep their buffers.
+  static void release(CachedResponse& s) {
+    s.key = (const char*)nullptr;
+    s.body = (const char*)nullptr;
+    s.gzip = (const char*)nullptr;
+  }
+
+  void evict(CachedResponse& s) {
+    stats.bytes -= entryBytes(s);
+    stats.evictions++;
+    release(s);
+    s.lastUse = 0;
+  }
+
+  // Frees a dropped entry once nothing sends it any more.
+  void drop(CachedResponse& s) {
+    s.lastUse = 0;
+    if (s.readers) return;
+    stats.bytes -= entryBytes(s);
+    release(s);
+  }
+
+  static void appendGzip(const uint8_t* data, size_t len, void* ctx) {
+    ((String*)ctx)->concat((const char*)data, len);
+  }
+
+  // What an openBody() response reads from.
+  struct EntryBody {
+    ResponseCache* cache;
+    CachedResponse* entry;
+    const String* bytes;
+    size_t offset;
+
+    static size_t read(void* ctx, char* buf, size_t cap) {
+      EntryBody& b = *(EntryBody*)ctx;
+      size_t n = b.bytes->length() - b.offset < cap ? b.bytes->length() - b.offset : cap;
+      memcpy(buf, b.bytes->c_str() + b.offset, n);
+      b.offset += n;
+      return n;
+    }
+
+    static void close(void* ctx) {
+      EntryBody* b = (EntryBody*)ctx;
+      CachedResponse& s = *b->entry;
+      if (--s.readers == 0 && !s.lastUse) b->cache->drop(s);
+      delete b;
+    }
+  };
+
+public:
+  ResponseCache(size_t byteBudget = RESPONSE_CACHE_BYTES) : budget(byteBudget), tick(0), generation(0) {
+    memset(&stats, 0, sizeof(stats));
+    for (int i = 0; i < RESPONSE_CACHE_SLOTS; i++) {
+      slots[i].lastUse = 0;
+      slots[i].readers = 0;
+    }
+  }
+
+  // Clears the cache if the content generation changed since the last call.
+  void sync(uint32_t contentGeneration) {
+    if (contentGeneration == generation) return;
+    clear();
+    generation = contentGeneration;
+  }
+
+  const CachedResponse* get(const String& key) {
+    for (int i = 0; i < RESPONSE_CACHE_SLOTS; i++) {
+      if (slots[i].lastUse && slots[i].key == key) {
+        slots[i].lastUse = ++tick;
+        stats.hits++;
+        return &slots[i];
+      }
+    }
+    stats.misses++;
+    return nullptr;
+  }
+
+  // Looks up key without touching the LRU order or the hit counters, e.g.
+  // to estimate the cost of a request before serving it.
+  const CachedResponse* peek(const String& key) const {
+    for (int i = 0; i < RESPONSE_CACHE_SLOTS; i++) {
+      if (slots[i].lastUse && slots[i].key == key) return &slots[i];
+    }
+    return nullptr;
+  }
+
+  // Takes ownership of body, computes its ETag and a gzip copy. With
+  // keepPlain false only the gzip copy is kept when compression worked, for
+  // pages that have their own uncompressed path. Pages larger than the
+  // budget are not kept; the returned entry is then nullptr and body is
+  // left as it was.
+  const CachedResponse* put(const String& key, String& body, bool keepPlain = true) {
+    if (key.length() + body.length() > budget) return nullptr;
+    String gzip;
+    gzip.reserve(body.length() / 2);
+    GzipWriter writer(appendGzip, &gzip);
+    // A copy that did not help is freed here, reserved buffer and all, so
+    // the entry holds only the bytes it is charged for
+    bool compressed = writer.compress(body.c_str(), body.length()) && gzip.length() < body.length();
+    if (!compressed) gzip = (const char*)nullptr;
+    bool plain = keepPlain || !compressed;
+    size_t size = key.length() + (compressed ? gzip.length() : 0) + (plain ? body.length() : 0);
+    if (size > budget) return nullptr;
+    CachedResponse* target = nullptr;
+    while (true) {
+      CachedResponse* lru = nullptr;
+      CachedResponse* empty = nullptr;
+      for (int i = 0; i < RESPONSE_CACHE_SLOTS; i++) {
+        CachedResponse& s = slots[i];
+        if (!s.lastUse) { if (!empty && !s.readers) empty = &s; }
+        else if (!s.readers && (!lru || s.lastUse < lru->lastUse)) lru = &s;
+      }
+      if (empty && stats.bytes + size <= budget) { target = empty; break; }
+      if (!lru) return nullptr;
+      evict(*lru);
+    }
+    target->key = key;
+    target->etag = contentHash(body.c_str(), body.length());
+    if (plain) target->body = std::move(body);
+    if (compressed) target->gzip = std::move(gzip);
+    target->lastUse = ++tick;
+    stats.bytes += size;
+    return target;
+  }
+
+  // Sets body to read page's body, or its gzip copy, as the client takes it
+  // (see HttpBodySource), instead of copying it into the output. False if
+  // there is no heap for the reader.
+  bool openBody(const CachedResponse& page, bool gzip, HttpBodySource& body) {
+    CachedResponse& s = slots[&page - slots];
+    EntryBody* b = new (std::nothrow) EntryBody{this, &s, gzip ? &s.gzip : &s.body, 0};
+    if (!b) return false;
+    s.readers++;
+    body.read = EntryBody::read;
+    body.close = EntryBody::close;
+    body.ctx = b;
+    body.remaining = b->bytes->length();
+    return true;
+  }
+
+  void countNotModified() { stats.notModified++; }
+
+  // Drops every entry; those still being sent are freed when they finish.
+  void clear() {
+    for (int i = 0; i < RESPONSE_CACHE_SLOTS; i++) {
+      if (slots[i].lastUse || slots[i].readers) drop(slots[i]);
+    }
+  }
+
+  const ResponseCacheStats& getStats() const { return stats; }
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+// Fixed-size queue between exactly one producer task and one consumer task.
+// No locks: each side only writes its own index, and the release/acquire
+// pair on it publishes the slot contents to the other side.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+private:
+  T items[N];
+  std::atomic<uint32_t> head;  // Next slot to read; written by the consumer
+  std::atomic<uint32_t> tail;  // Next slot to write; written by the producer
+
+public:
+  SpscQueue() : head(0), tail(0) {}
+
+  // Producer side. Returns false if the queue is full.
+  bool push(const T& item) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == N) return false;
+    items[t & (N - 1)] = item;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false if the queue is empty.
+  bool pop(T& item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return false;
+    item = items[h & (N - 1)];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+};
+
+#endif
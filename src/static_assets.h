@@ -0,0 +1,96 @@
+#ifndef STATIC_ASSETS_H
+#define STATIC_ASSETS_H
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include "content_format.h"
+
+#define STATIC_URL_PREFIX "/static/"
+#define STATIC_URL_MAX 48
+
+// A stylesheet or script kept as a plain file in data/. It is served under a
+// URL carrying its content hash ("/static/app.1a2b3c4d.css"), so browsers may
+// keep it forever: an edited file gets a new URL.
+struct StaticAsset {
+  const char* path;  // SPIFFS path, e.g. "/app.css"
+  const char* type;  // Content-Type
+  char url[STATIC_URL_MAX];
+  size_t urlLength;
+  size_t size;
+  uint32_t hash;
+  bool present;
+
+  StaticAsset(const char* p, const char* t) : path(p), type(t), urlLength(0), size(0), hash(0), present(false) { url[0] = '\0'; }
+};
+
+class StaticAssets {
+private:
+  StaticAsset* assets;
+  int count;
+  uint32_t version;
+
+  // "/app.css" + hash -> "/static/app.1a2b3c4d.css"
+  static void buildUrl(StaticAsset& a) {
+    const char* name = a.path[0] == '/' ? a.path + 1 : a.path;
+    const char* ext = strrchr(name, '.');
+    if (!ext) ext = name + strlen(name);
+    int n = snprintf(a.url, sizeof(a.url), STATIC_URL_PREFIX "%.*s.%08x%s", (int)(ext - name), name, (unsigned)a.hash, ext);
+    a.urlLength = n < (int)sizeof(a.url) ? n : sizeof(a.url) - 1;
+  }
+
+  static bool hashFile(StaticAsset& a) {
+    File file = SPIFFS.open(a.path, "r");
+    if (!file) return false;
+    uint32_t h = contentHash("", 0);
+    size_t total = 0;
+    char buf[256];
+    size_t n;
+    while ((n = file.read((uint8_t*)buf, sizeof(buf))) > 0) {
+      h = contentHash(buf, n, h);
+      total += n;
+    }
+    file.close();
+    a.hash = h;
+    a.size = total;
+    return true;
+  }
+
+public:
+  StaticAssets(StaticAsset* table, int tableSize) : assets(table), count(tableSize), version(0) {}
+
+  // Hashes every asset file; call once SPIFFS is mounted and again after the
+  // files may have changed.
+  void load() {
+    version = 0;
+    for (int i = 0; i < count; i++) {
+      StaticAsset& a = assets[i];
+      a.present = hashFile(a);
+      if (!a.present) {
+        a.hash = 0;
+        a.size = 0;
+        Serial.println("Static asset " + String(a.path) + " missing; pages will load without it");
+      }
+      buildUrl(a);
+      version = contentHash(a.url, a.urlLength, version ^ a.hash);
+    }
+  }
+
+  // Versioned URL of asset i, for pages to link to.
+  TextSpan url(int i) const { return TextSpan(assets[i].url, assets[i].urlLength); }
+
+  // Changes whenever any asset does, so pages linking to them can fold it
+  // into their own ETag.
+  uint32_t getVersion() const { return version; }
+
+  // The asset served at path, or nullptr. URLs with an outdated hash do not
+  // match: the old bytes are gone.
+  const StaticAsset* find(TextSpan path) const {
+    for (int i = 0; i < count; i++) {
+      const StaticAsset& a = assets[i];
+      if (a.present && a.urlLength == path.len && memcmp(a.url, path.ptr, path.len) == 0) return &a;
+    }
+    return nullptr;
+  }
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef TASK_RUNNER_H
+#define TASK_RUNNER_H
+
+// Runs a function over and over on its own task: a FreeRTOS task pinned to
+// one core on the ESP32, a std::thread (pinned to a CPU where Linux allows
+// it) elsewhere, so the same split can be exercised on a host build.
+
+#include <stddef.h>
+#include <stdint.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#include <thread>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#endif
+
+#define TASK_MAX 4
+
+// One pass of a task's work; the runner calls it forever.
+typedef void (*TaskBody)(void* ctx);
+
+struct TaskSpec {
+  TaskBody body;
+  void* ctx;
+};
+
+inline TaskSpec* taskSlot() {
+  static TaskSpec specs[TASK_MAX];
+  static int used = 0;
+  return used < TASK_MAX ? &specs[used++] : nullptr;
+}
+
+inline void taskLoop(void* arg) {
+  TaskSpec* spec = (TaskSpec*)arg;
+  for (;;) spec->body(spec->ctx);
+}
+
+// Starts body(ctx) on a new task. stackBytes and priority only apply on the
+// ESP32. Returns false if the task could not be created.
+inline bool startTask(const char* name, TaskBody body, void* ctx, int core, uint32_t stackBytes, int priority) {
+  TaskSpec* spec = taskSlot();
+  if (!spec) return false;
+  spec->body = body;
+  spec->ctx = ctx;
+#ifdef ARDUINO
+  return xTaskCreatePinnedToCore(taskLoop, name, stackBytes, spec, priority, nullptr, core) == pdPASS;
+#else
+  (void)stackBytes;
+  (void)priority;
+  std::thread thread(taskLoop, spec);
+#ifdef __linux__
+  if (core >= 0 && core < (int)std::thread::hardware_concurrency()) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+  }
+  pthread_setname_np(thread.native_handle(), name);  // Shown by top -H; at most 15 chars
+#else
+  (void)core;
+  (void)name;
+#endif
+  thread.detach();
+  return true;
+#endif
+}
+
+// Gives the core to other tasks for about ms milliseconds.
+inline void taskSleep(uint32_t ms) {
+#ifdef ARDUINO
+  vTaskDelay(ms / portTICK_PERIOD_MS > 0 ? ms / portTICK_PERIOD_MS : 1);
+#else
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+#endif
+}
+
+#endif
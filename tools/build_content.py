@@ -0,0 +1,93 @@
+# PlatformIO extra script: before the filesystem image is built, writes
+# data/content.idx (the manifest) and compiles data/ into data/content.pack,
+# so the firmware boots without scanning files or parsing Markdown.
+#
+#   pio run -t buildfs      (runs automatically)
+#   pio run -t content      (just regenerate the pack)
+#
+# The manifest only needs Python. The compiler is a host program
+# (tools/contentc); if no host toolchain is available the pack is skipped with
+# a warning and the firmware renders the raw files on the device.
+
+Import("env")
+
+import os
+import subprocess
+
+PROJECT_DIR = env.subst("$PROJECT_DIR")
+DATA_DIR = env.subst("$PROJECT_DATA_DIR")
+TOOL_DIR = os.path.join(PROJECT_DIR, "tools", "contentc")
+PACK_PATH = os.path.join(DATA_DIR, "content.pack")
+MANIFEST_PATH = os.path.join(DATA_DIR, "content.idx")
+MANIFEST_HEADER = "innov8-manifest 3"
+
+
+def content_hash(data):
+    # Same 32-bit FNV-1a as contentHash() in src/content_format.h
+    h = 2166136261
+    for b in bytearray(data):
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def field(text):
+    return text.replace("\t", " ").replace("\n", " ")
+
+
+# Mirrors splitModulePrefix(), contentKindOf(), lessonIdFromName() and
+# lessonTitleOf() in src/content_format.h.
+def write_manifest():
+    lessons = []
+    quizzes = []
+    for name in sorted(os.listdir(DATA_DIR)):
+        path = os.path.join(DATA_DIR, name)
+        if name.startswith(".") or not os.path.isfile(path):
+            continue
+        module, _, rest = name.partition("_")
+        if not module or not rest:
+            module, rest = "general", name
+        with open(path, "rb") as f:
+            data = f.read()
+        record = (module, "/" + name, len(data), content_hash(data))
+        if rest.endswith((".content", ".md")):
+            lesson_id = 0
+            if "." in rest and rest[0].isdigit():
+                digits = rest[: len(rest) - len(rest.lstrip("0123456789"))]
+                lesson_id = int(digits)
+            start = data.find(b"# ")
+            if start < 0:
+                title = "Untitled"
+            else:
+                end = data.find(b"\n", start + 2)
+                title = data[start + 2 : end if end >= 0 else len(data)].decode("utf-8", "replace")
+            lessons.append((record, lesson_id, title))
+        elif rest.endswith((".quiz", ".txt")):
+            quizzes.append(record)
+
+    with open(MANIFEST_PATH, "w", newline="\n", encoding="utf-8") as out:
+        out.write("%s\t%d\n" % (MANIFEST_HEADER, len(lessons) + len(quizzes)))
+        for (module, path, size, digest), lesson_id, title in lessons:
+            out.write("L\t%s\t%d\t%s\t%s\t%d\t%08x\n" % (module, lesson_id, field(title), path, size, digest))
+        for module, path, size, digest in quizzes:
+            out.write("Q\t%s\t%s\t%d\t%08x\n" % (module, path, size, digest))
+
+
+def build_pack(*args, **kwargs):
+    write_manifest()
+    try:
+        subprocess.check_call(["make", "-s", "-C", TOOL_DIR])
+        subprocess.check_call([os.path.join(TOOL_DIR, "contentc"), "-o", PACK_PATH, DATA_DIR])
+    except (OSError, subprocess.CalledProcessError) as e:
+        print("Warning: content compiler unavailable (%s); device will render raw files" % e)
+        if os.path.exists(PACK_PATH):
+            os.remove(PACK_PATH)
+
+
+env.AddPreAction("$BUILD_DIR/${ESP32_FS_IMAGE_NAME}.bin", build_pack)
+env.AddCustomTarget(
+    name="content",
+    dependencies=None,
+    actions=[build_pack],
+    title="Build Content Pack",
+    description="Pre-render data/ into data/content.pack",
+)
@@ -0,0 +1,517 @@
+// contentc: host-side content compiler.
+//
+// Walks a data/ directory with the same [module]_[id].[title].ext grouping
+// the firmware uses, renders every lesson with md4c and writes a single
+// /content.pack image (see src/content_pack.h) that the ESP32 boots from
+// without parsing any Markdown.
+//
+//   contentc [-o data/content.pack] [-q] [-p] [-z] data/
+//   contentc -Q questions
+//   contentc -I data/
+//   contentc -D data/content.pack
+//
+// -p prints the boot profile table (src/boot_profile.h) for the corpus:
+// read and render time per file and the HTML each lesson produces.
+// -z prints how well each lesson's HTML compresses with the firmware's
+// gzip encoder (src/gzip_writer.h).
+// -Q times the quiz parser (QuizReader) on a generated quiz with that many
+// questions and exits.
+// -I times reading every lesson and quiz in a directory, byte by byte as the
+// firmware once did and in blocks through its IngestBuffer
+// (src/file_ingest.h), and prints MB/s for each. Files come from the page
+// cache after the first pass, so this measures the CPU cost of a read.
+// -D decodes the quizzes in a pack back to the quiz text format on stdout,
+// reading them the way the firmware does.
+//
+// Every pack written is decoded again before contentc exits, and each quiz
+// question compared with its source, so a format change that does not
+// round-trip fails the build instead of showing up on the board.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <string>
+#include <vector>
+
+#include "boot_profile.h"
+#include "content_format.h"
+#include "content_pack.h"
+#include "file_ingest.h"
+#include "gzip_writer.h"
+#include "md4c-html.h"
+
+struct SourceFile {
+  std::string name;  // e.g. "math_1.intro.content"
+  std::string text;
+};
+
+struct LessonOut {
+  int id;
+  PackStr title;
+  uint32_t hash;
+  std::string html;
+};
+
+// A parsed question with its options copied out of the reader.
+struct SourceQuestion {
+  TextSpan question;
+  std::vector<TextSpan> options;
+  char correctAnswer;
+};
+
+struct ModuleOut {
+  std::string id;
+  std::vector<LessonOut> lessons;
+  std::vector<PackQuestion> questions;
+  std::vector<std::string> blocks;         // quizBlockEncode() of each question
+  std::vector<SourceQuestion> sources;     // as parsed, for the round-trip check
+  uint32_t quizHash = 0;
+};
+
+static std::string pool;
+static bool quiet = false;
+static bool profiling = false;
+static bool gzipReport = false;
+
+static uint32_t clockMicros() {
+  using namespace std::chrono;
+  return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void appendGzip(const uint8_t* data, size_t len, void* ctx) {
+  ((std::string*)ctx)->append((const char*)data, len);
+}
+
+struct StdoutPrinter {
+  void print(const char* s) { fputs(s, stdout); }
+};
+
+static PackStr intern(TextSpan s) {
+  PackStr r = { (uint32_t)pool.size(), (uint32_t)s.len };
+  pool.append(s.ptr, s.len);
+  return r;
+}
+
+static bool readFile(const std::string& path, std::string& out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  char buf[4096];
+  size_t n;
+  out.clear();
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+  fclose(f);
+  return true;
+}
+
+static void appendHtml(const MD_CHAR* text, MD_SIZE size, void* userdata) {
+  ((std::string*)userdata)->append(text, size);
+}
+
+static void printQuizError(uint32_t line, const char* message, void* ctx) {
+  fprintf(stderr, "contentc: %s:%u: %s\n", (const char*)ctx, (unsigned)line, message);
+}
+
+// A quiz in the data/ format with two to six options a question and some
+// long and multi-line questions.
+static std::string syntheticQuiz(int questions) {
+  std::string quiz = "# Generated Quiz\n\n## Instructions\nAnswer all questions.\n\n---\n\n";
+  char buf[160];
+  for (int i = 0; i < questions; i++) {
+    snprintf(buf, sizeof(buf), "### Question %d (2 points)\nWhat is %d + %d?\n", i + 1, i, i % 7);
+    quiz += buf;
+    if (i % 10 == 0) quiz += std::string(600, 'x') + "\nsecond line of a long question\n";
+    quiz += "\n";
+    for (int j = 0; j < 2 + i % 5; j++) {
+      snprintf(buf, sizeof(buf), "%c) %d\n", 'a' + j, i + i % 7 + j - 1);
+      quiz += buf;
+    }
+    quiz += i % 2 ? "\n**Answer: b**\n\n---\n\n" : "\n**Sagot: b) ok**\n\n";
+  }
+  return quiz;
+}
+
+static int benchQuizParser(int questions) {
+  std::string quiz = syntheticQuiz(questions);
+  int found = 0;
+  int runs = 0;
+  uint32_t start = clockMicros();
+  uint32_t elapsed;
+  do {
+    QuizReader reader(quiz.data(), quiz.size(), printQuizError, (void*)"synthetic");
+    QuizQuestionSpans q;
+    found = 0;
+    while (reader.next(q)) found++;
+    runs++;
+    elapsed = clockMicros() - start;
+  } while (elapsed < 500000);
+  double seconds = elapsed / 1e6 / runs;
+  printf("%d questions, %zu bytes: %.3f ms per parse, %.1f MB/s, %.0f questions/s\n", found, quiz.size(),
+         seconds * 1000, quiz.size() / seconds / 1e6, found / seconds);
+  return found == questions ? 0 : 1;
+}
+
+// The part of fs::File that IngestBuffer::load() uses.
+struct HostFile {
+  FILE* f;
+  size_t bytes;
+  explicit HostFile(FILE* file) : f(file), bytes(0) {
+    fseek(f, 0, SEEK_END);
+    bytes = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+  }
+  size_t size() const { return bytes; }
+  size_t read(uint8_t* buf, size_t n) { return fread(buf, 1, n, f); }
+};
+
+// Lessons and quizzes of dir, by path.
+static std::vector<std::string> contentFiles(const std::string& dir) {
+  std::vector<std::string> paths;
+  DIR* d = opendir(dir.c_str());
+  if (!d) return paths;
+  while (dirent* e = readdir(d)) {
+    TextSpan moduleId, fileName;
+    splitModulePrefix(TextSpan(e->d_name, strlen(e->d_name)), moduleId, fileName);
+    if (e->d_name[0] != '.' && contentKindOf(fileName) != CONTENT_NONE) paths.push_back(dir + "/" + e->d_name);
+  }
+  closedir(d);
+  return paths;
+}
+
+// Reads every file once; returns the bytes read, or 0 on a failed read.
+static size_t ingestPerByte(const std::vector<std::string>& paths) {
+  size_t total = 0;
+  for (const std::string& path : paths) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return 0;
+    std::string content;  // grown a byte at a time, as String += char was
+    int c;
+    while ((c = fgetc(f)) != EOF) content += (char)c;
+    fclose(f);
+    total += content.size();
+  }
+  return total;
+}
+
+static size_t ingestBlocks(const std::vector<std::string>& paths, IngestBuffer& ingest) {
+  size_t total = 0;
+  for (const std::string& path : paths) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return 0;
+    HostFile file(f);
+    TextSpan view;
+    bool ok = ingest.load(file, view);
+    fclose(f);
+    if (!ok) return 0;
+    total += view.len;
+  }
+  return total;
+}
+
+static int benchIngest(const std::string& dir) {
+  std::vector<std::string> paths = contentFiles(dir);
+  if (paths.empty()) { fprintf(stderr, "contentc: no lessons or quizzes in %s\n", dir.c_str()); return 1; }
+  IngestBuffer ingest;
+  size_t bytes = ingestBlocks(paths, ingest);  // warms the page cache
+  if (bytes == 0) { fprintf(stderr, "contentc: cannot read %s\n", dir.c_str()); return 1; }
+  printf("%zu files, %zu bytes\n", paths.size(), bytes);
+  for (int blocks = 0; blocks < 2; blocks++) {
+    int runs = 0;
+    uint32_t start = clockMicros();
+    uint32_t elapsed;
+    do {
+      if ((blocks ? ingestBlocks(paths, ingest) : ingestPerByte(paths)) != bytes) {
+        fprintf(stderr, "contentc: %s changed while reading\n", dir.c_str());
+        return 1;
+      }
+      runs++;
+      elapsed = clockMicros() - start;
+    } while (elapsed < 500000);
+    double seconds = elapsed / 1e6 / runs;
+    printf("%-14s %.3f ms per pass, %.1f MB/s\n", blocks ? "IngestBuffer" : "per byte", seconds * 1000, bytes / seconds / 1e6);
+  }
+  return 0;
+}
+
+static bool spanEqual(TextSpan a, TextSpan b) { return a.len == b.len && memcmp(a.ptr, b.ptr, a.len) == 0; }
+
+// Reads every question of a finished image back with quizBlockDecode(), as
+// the firmware will, and compares it with what the quiz file said.
+static bool quizzesRoundTrip(const std::string& image, const std::vector<ModuleOut>& modules) {
+  const PackHeader& h = *(const PackHeader*)image.data();
+  const PackQuestion* table = (const PackQuestion*)(image.data() + packQuestionsOffset(h));
+  size_t qi = 0;
+  for (const ModuleOut& m : modules) {
+    for (size_t i = 0; i < m.sources.size(); i++, qi++) {
+      const PackQuestion& pq = table[qi];
+      const SourceQuestion& src = m.sources[i];
+      QuizQuestionSpans got;
+      bool ok = quizBlockDecode(image.data() + pq.blockOffset, pq.blockLength, pq.optionCount, got) &&
+                'a' + pq.answer == src.correctAnswer && spanEqual(got.question, src.question) &&
+                got.optionCount == (int)src.options.size();
+      for (int j = 0; ok && j < got.optionCount; j++) ok = spanEqual(got.option(j), src.options[j]);
+      if (!ok) {
+        fprintf(stderr, "contentc: internal error, question %zu of %s does not round-trip\n", i + 1, m.id.c_str());
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Prints span with each line on its own, trimmed, as QuizReader reads it.
+static void printLines(const char* prefix, TextSpan s) {
+  fputs(prefix, stdout);
+  for (size_t i = 0; i < s.len; i++) {
+    if (s.ptr[i] != '\n') { putchar(s.ptr[i]); continue; }
+    putchar('\n');
+    while (i + 1 < s.len && (s.ptr[i + 1] == ' ' || s.ptr[i + 1] == '\t')) i++;
+  }
+  putchar('\n');
+}
+
+static int decodeQuizzes(const char* path) {
+  std::string image;
+  if (!readFile(path, image)) { fprintf(stderr, "contentc: cannot read %s\n", path); return 1; }
+  const PackHeader* h = (const PackHeader*)image.data();
+  if (image.size() < sizeof(PackHeader) || !packIndexValid((const uint8_t*)image.data(), h->indexSize, image.size())) {
+    fprintf(stderr, "contentc: %s is not a valid version %d pack\n", path, CONTENT_PACK_VERSION);
+    return 1;
+  }
+  const PackModule* mods = (const PackModule*)(image.data() + packModulesOffset(*h));
+  const PackQuestion* table = (const PackQuestion*)(image.data() + packQuestionsOffset(*h));
+  const char* strings = image.data() + packStringsOffset(*h);
+  for (unsigned i = 0; i < h->moduleCount; i++) {
+    const PackModule& pm = mods[i];
+    if (pm.questionCount == 0) continue;
+    printf("# %.*s\n\n", (int)pm.name.length, strings + pm.name.offset);
+    for (unsigned j = 0; j < pm.questionCount; j++) {
+      const PackQuestion& pq = table[pm.firstQuestion + j];
+      QuizQuestionSpans q;
+      if (!quizBlockDecode(image.data() + pq.blockOffset, pq.blockLength, pq.optionCount, q)) {
+        fprintf(stderr, "contentc: %s: question %u of module %u is damaged\n", path, j + 1, i);
+        return 1;
+      }
+      printf("### Question %u\n", j + 1);
+      printLines("", q.question);
+      putchar('\n');
+      for (int k = 0; k < q.optionCount; k++) {
+        char prefix[4] = { (char)('a' + k), ')', ' ', '\0' };
+        printLines(prefix, q.option(k));
+      }
+      printf("\n**Answer: %c**\n\n---\n\n", 'a' + pq.answer);
+    }
+  }
+  return 0;
+}
+
+static ModuleOut& moduleFor(std::vector<ModuleOut>& modules, TextSpan id) {
+  for (ModuleOut& m : modules) {
+    if (m.id.size() == id.len && memcmp(m.id.data(), id.ptr, id.len) == 0) return m;
+  }
+  modules.push_back(ModuleOut());
+  modules.back().id.assign(id.ptr, id.len);
+  return modules.back();
+}
+
+int main(int argc, char** argv) {
+  std::string dataDir;
+  std::string outPath;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-o") && i + 1 < argc) outPath = argv[++i];
+    else if (!strcmp(argv[i], "-Q") && i + 1 < argc) return benchQuizParser(atoi(argv[++i]));
+    else if (!strcmp(argv[i], "-I") && i + 1 < argc) return benchIngest(argv[++i]);
+    else if (!strcmp(argv[i], "-D") && i + 1 < argc) return decodeQuizzes(argv[++i]);
+    else if (!strcmp(argv[i], "-q")) quiet = true;
+    else if (!strcmp(argv[i], "-p")) profiling = true;
+    else if (!strcmp(argv[i], "-z")) gzipReport = true;
+    else if (argv[i][0] != '-') dataDir = argv[i];
+    else { fprintf(stderr, "usage: contentc [-o out.pack] [-q] [-p] [-z] data_dir | -Q questions | -I data_dir | -D pack\n"); return 2; }
+  }
+  if (dataDir.empty()) { fprintf(stderr, "usage: contentc [-o out.pack] [-q] [-p] [-z] data_dir | -Q questions | -I data_dir | -D pack\n"); return 2; }
+  if (outPath.empty()) outPath = dataDir + CONTENT_PACK_PATH;
+
+  // Host heap is not comparable to the ESP32's, so those columns stay 0
+  BootProfile profile(clockMicros, nullptr);
+  BootRecord& readPhase = profile.beginPhase("read");
+  DIR* dir = opendir(dataDir.c_str());
+  if (!dir) { fprintf(stderr, "contentc: cannot open %s\n", dataDir.c_str()); return 1; }
+  std::vector<SourceFile> files;
+  while (dirent* e = readdir(dir)) {
+    TextSpan name(e->d_name, strlen(e->d_name));
+    if (name.ptr[0] == '.') continue;
+    TextSpan moduleId, fileName;
+    splitModulePrefix(name, moduleId, fileName);
+    if (contentKindOf(fileName) == CONTENT_NONE) continue;
+    SourceFile f;
+    f.name = e->d_name;
+    if (!readFile(dataDir + "/" + f.name, f.text)) { fprintf(stderr, "contentc: cannot read %s\n", f.name.c_str()); return 1; }
+    readPhase.bytesRead += (uint32_t)f.text.size();
+    files.push_back(f);
+  }
+  closedir(dir);
+  profile.end(readPhase);
+  // SPIFFS has no stable directory order; sort so the image is reproducible.
+  std::sort(files.begin(), files.end(), [](const SourceFile& a, const SourceFile& b) { return a.name < b.name; });
+
+  std::vector<ModuleOut> modules;
+  BootRecord& parsePhase = profile.beginPhase("parse");
+  for (const SourceFile& f : files) {
+    BootRecord& record = profile.beginFile(f.name.data(), f.name.size());
+    record.bytesRead = (uint32_t)f.text.size();
+    TextSpan moduleId, fileName;
+    splitModulePrefix(TextSpan(f.name.data(), f.name.size()), moduleId, fileName);
+    ModuleOut& m = moduleFor(modules, moduleId);
+    TextSpan text(f.text.data(), f.text.size());
+
+    if (contentKindOf(fileName) == CONTENT_LESSON) {
+      LessonOut l;
+      l.id = lessonIdFromName(fileName);
+      l.title = intern(lessonTitleOf(text));
+      l.hash = contentHash(text.ptr, text.len);
+      if (md_html(f.text.data(), (MD_SIZE)f.text.size(), appendHtml, &l.html, 0, 0) != 0) {
+        fprintf(stderr, "contentc: failed to render %s\n", f.name.c_str());
+        return 1;
+      }
+      record.htmlBytes = (uint32_t)l.html.size();
+      parsePhase.htmlBytes += record.htmlBytes;
+      m.lessons.push_back(l);
+    } else {
+      m.quizHash = contentHash(text.ptr, text.len);
+      QuizReader reader(text.ptr, text.len, printQuizError, (void*)f.name.c_str());
+      QuizQuestionSpans q;
+      char block[QUIZ_BLOCK_MAX];
+      while (reader.next(q)) {
+        size_t len = quizBlockEncode(q, block, sizeof(block));
+        if (len == 0) {
+          fprintf(stderr, "contentc: %s: question over %u bytes\n", f.name.c_str(), (unsigned)QUIZ_BLOCK_MAX);
+          return 1;
+        }
+        PackQuestion pq;
+        pq.blockOffset = 0;
+        pq.blockLength = (uint16_t)len;
+        pq.optionCount = (uint8_t)q.optionCount;
+        pq.answer = (uint8_t)(q.correctAnswer - 'a');
+        m.questions.push_back(pq);
+        m.blocks.push_back(std::string(block, len));
+        SourceQuestion src;
+        src.question = q.question;
+        for (int j = 0; j < q.optionCount; j++) src.options.push_back(q.option(j));
+        src.correctAnswer = q.correctAnswer;
+        m.sources.push_back(src);
+      }
+    }
+    parsePhase.bytesRead += record.bytesRead;
+    profile.end(record);
+  }
+  profile.end(parsePhase);
+
+  PackHeader h;
+  memset(&h, 0, sizeof(h));
+  h.magic = CONTENT_PACK_MAGIC;
+  h.version = CONTENT_PACK_VERSION;
+  std::vector<PackModule> modTable;
+  std::vector<PackLesson> lessonTable;
+  std::vector<PackQuestion> questionTable;
+  for (ModuleOut& m : modules) {
+    std::stable_sort(m.lessons.begin(), m.lessons.end(), [](const LessonOut& a, const LessonOut& b) { return a.id < b.id; });
+    char name[128];
+    size_t nameLen = moduleNameInto(TextSpan(m.id.data(), m.id.size()), name, sizeof(name));
+    PackModule pm;
+    pm.id = intern(TextSpan(m.id.data(), m.id.size()));
+    pm.name = intern(TextSpan(name, nameLen));
+    pm.firstLesson = (uint16_t)lessonTable.size();
+    pm.lessonCount = (uint16_t)m.lessons.size();
+    pm.firstQuestion = (uint16_t)questionTable.size();
+    pm.questionCount = (uint16_t)m.questions.size();
+    pm.quizHash = m.quizHash;
+    modTable.push_back(pm);
+    for (const LessonOut& l : m.lessons) {
+      PackLesson pl;
+      pl.id = l.id;
+      pl.title = l.title;
+      pl.bodyOffset = 0;
+      pl.bodyLength = (uint32_t)l.html.size();
+      pl.hash = l.hash;
+      lessonTable.push_back(pl);
+    }
+    questionTable.insert(questionTable.end(), m.questions.begin(), m.questions.end());
+  }
+  if (lessonTable.size() > 0xFFFF || questionTable.size() > 0xFFFF) {
+    fprintf(stderr, "contentc: too many lessons or questions for one pack\n");
+    return 1;
+  }
+
+  h.moduleCount = (uint16_t)modTable.size();
+  h.lessonCount = (uint16_t)lessonTable.size();
+  h.questionCount = (uint16_t)questionTable.size();
+  h.stringPoolSize = (uint32_t)pool.size();
+  h.indexSize = (uint32_t)(packStringsOffset(h) + pool.size());
+
+  std::string bodies;
+  size_t li = 0;
+  for (const ModuleOut& m : modules) {
+    for (const LessonOut& l : m.lessons) {
+      lessonTable[li++].bodyOffset = (uint32_t)(h.indexSize + bodies.size());
+      bodies += l.html;
+    }
+  }
+  size_t quizStart = bodies.size();
+  size_t qi = 0;
+  for (const ModuleOut& m : modules) {
+    for (const std::string& block : m.blocks) {
+      questionTable[qi++].blockOffset = (uint32_t)(h.indexSize + bodies.size());
+      bodies += block;
+    }
+  }
+  h.bodySize = (uint32_t)bodies.size();
+
+  std::string image((const char*)&h, sizeof(h));
+  image.append((const char*)modTable.data(), modTable.size() * sizeof(PackModule));
+  image.append((const char*)lessonTable.data(), lessonTable.size() * sizeof(PackLesson));
+  image.append((const char*)questionTable.data(), questionTable.size() * sizeof(PackQuestion));
+  image += pool;
+  image += bodies;
+  if (!packIndexValid((const uint8_t*)image.data(), h.indexSize, image.size())) {
+    fprintf(stderr, "contentc: internal error, generated index does not validate\n");
+    return 1;
+  }
+  if (!quizzesRoundTrip(image, modules)) return 1;
+
+  BootRecord& writePhase = profile.beginPhase("write pack");
+  FILE* out = fopen(outPath.c_str(), "wb");
+  if (!out || fwrite(image.data(), 1, image.size(), out) != image.size() || fclose(out) != 0) {
+    fprintf(stderr, "contentc: cannot write %s\n", outPath.c_str());
+    return 1;
+  }
+  profile.end(writePhase);
+  if (profiling) {
+    StdoutPrinter printer;
+    profile.printTable(printer);
+  }
+  if (gzipReport) {
+    size_t rawTotal = 0, gzTotal = 0;
+    printf("%-24s %6s %8s %8s %6s\n", "module", "lesson", "html", "gzip", "ratio");
+    for (const ModuleOut& m : modules) {
+      for (const LessonOut& l : m.lessons) {
+        std::string gz;
+        GzipWriter writer(appendGzip, &gz);
+        writer.compress(l.html.data(), l.html.size());
+        rawTotal += l.html.size();
+        gzTotal += gz.size();
+        printf("%-24s %6d %8zu %8zu %5.1f%%\n", m.id.c_str(), l.id, l.html.size(), gz.size(),
+               l.html.empty() ? 0.0 : 100.0 * gz.size() / l.html.size());
+      }
+    }
+    printf("%-24s %6s %8zu %8zu %5.1f%%\n", "total", "", rawTotal, gzTotal, rawTotal ? 100.0 * gzTotal / rawTotal : 0.0);
+  }
+  if (!quiet) {
+    for (size_t i = 0; i < modTable.size(); i++) {
+      printf("%-12s %u lessons, %u questions\n", modules[i].id.c_str(), modTable[i].lessonCount, modTable[i].questionCount);
+    }
+    printf("%s: index %u bytes, lesson bodies %zu bytes, quiz blocks %zu bytes\n", outPath.c_str(), h.indexSize,
+           quizStart, bodies.size() - quizStart);
+  }
+  return 0;
+}
@@ -0,0 +1,162 @@
+#ifndef HOSTSIM_ARDUINO_H
+#define HOSTSIM_ARDUINO_H
+
+// The part of the Arduino core the firmware uses, on top of the C++ standard
+// library, so src/ builds and runs unchanged on a Linux host.
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+
+typedef uint8_t byte;
+
+inline unsigned long millis() {
+  using namespace std::chrono;
+  static const steady_clock::time_point start = steady_clock::now();
+  return (unsigned long)duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+inline unsigned long micros() {
+  using namespace std::chrono;
+  static const steady_clock::time_point start = steady_clock::now();
+  return (unsigned long)duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+inline void delay(unsigned long) {}
+inline void yield() {}
+
+class String {
+private:
+  std::string s;
+
+public:
+  String() {}
+  String(const char* c) { if (c) s = c; }
+  String(const std::string& str) : s(str) {}
+  explicit String(char c) : s(1, c) {}
+  String(int v) : s(std::to_string(v)) {}
+  String(unsigned v) : s(std::to_string(v)) {}
+  String(long v) : s(std::to_string(v)) {}
+  String(unsigned long v) : s(std::to_string(v)) {}
+
+  // As on the board: assigning a null string frees the buffer, while
+  // assigning an empty String keeps it for reuse.
+  String& operator=(const char* c) {
+    if (c) s = c;
+    else std::string().swap(s);
+    return *this;
+  }
+
+  unsigned length() const { return (unsigned)s.size(); }
+  const char* c_str() const { return s.c_str(); }
+  char operator[](unsigned i) const { return i < s.size() ? s[i] : 0; }
+  bool reserve(unsigned n) { s.reserve(n); return true; }
+
+  bool concat(const char* c, unsigned n) { s.append(c, n); return true; }
+  bool concat(const char* c) { s.append(c); return true; }
+  bool concat(const String& o) { s.append(o.s); return true; }
+  bool concat(char c) { s.push_back(c); return true; }
+  String& operator+=(const String& o) { s += o.s; return *this; }
+  String& operator+=(const char* o) { s += o; return *this; }
+  String& operator+=(char c) { s += c; return *this; }
+
+  bool operator==(const String& o) const { return s == o.s; }
+  bool operator==(const char* o) const { return s == o; }
+  bool operator!=(const String& o) const { return s != o.s; }
+  bool operator!=(const char* o) const { return s != o; }
+
+  int indexOf(const char* c, unsigned from = 0) const {
+    size_t p = s.find(c, from);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  int indexOf(char c, unsigned from = 0) const {
+    size_t p = s.find(c, from);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  bool startsWith(const String& p) const { return s.compare(0, p.s.size(), p.s) == 0; }
+  bool endsWith(const String& p) const { return s.size() >= p.s.size() && s.compare(s.size() - p.s.size(), p.s.size(), p.s) == 0; }
+  String substring(unsigned from) const { return from >= s.size() ? String() : String(s.substr(from)); }
+  String substring(unsigned from, unsigned to) const {
+    if (to > s.size()) to = (unsigned)s.size();
+    return from >= to ? String() : String(s.substr(from, to - from));
+  }
+  void trim() {
+    size_t a = s.find_first_not_of(" \t\r\n");
+    if (a == std::string::npos) { s.clear(); return; }
+    s = s.substr(a, s.find_last_not_of(" \t\r\n") - a + 1);
+  }
+  long toInt() const { return atol(s.c_str()); }
+
+  friend String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+  friend String operator+(const String& a, const char* b) { return String(a.s + b); }
+  friend String operator+(const char* a, const String& b) { return String(a + b.s); }
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(const uint8_t* data, size_t len) = 0;
+  size_t write(const char* data, size_t len) { return write((const uint8_t*)data, len); }
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t print(const String& s) { return write(s.c_str(), s.length()); }
+  size_t print(const char* s) { return write(s, strlen(s)); }
+  size_t print(char c) { return write(&c, 1); }
+  size_t print(int v) { return print(String(v)); }
+  size_t print(unsigned v) { return print(String(v)); }
+  size_t print(long v) { return print(String(v)); }
+  size_t print(unsigned long v) { return print(String(v)); }
+  template <typename T>
+  size_t println(const T& v) { return print(v) + print("\n"); }
+  size_t println() { return print("\n"); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[1024];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (n < 0) return 0;
+    return write(buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() { return 0; }
+  String readStringUntil(char) { return String(); }
+};
+
+// Serial goes to hostSerialOut (stdout unless the host program changes it);
+// the console has no input.
+extern FILE* hostSerialOut;
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  size_t write(const uint8_t* data, size_t len) override {
+    return hostSerialOut ? fwrite(data, 1, len, hostSerialOut) : len;
+  }
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+// Heap figures for the boot profile: fixed, the host has no such limits.
+struct EspClass {
+  uint32_t getFreeHeap() { return 200000; }
+  uint32_t getMaxAllocHeap() { return 110000; }
+};
+
+extern EspClass ESP;
+
+// The ESP32's hardware random number generator.
+inline uint32_t esp_random() {
+  static std::random_device device;
+  return device();
+}
+
+#endif
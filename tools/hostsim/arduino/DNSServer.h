@@ -0,0 +1,62 @@
+#ifndef HOSTSIM_DNSSERVER_H
+#define HOSTSIM_DNSSERVER_H
+
+// Captive-portal DNS on a UDP port of loopback: like the board's, every
+// query is answered with the portal's address. Port 53 needs root, so the
+// server listens on hostDnsPort instead; 0 (the default) leaves DNS out, as
+// host clients connect by address.
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "WiFi.h"
+
+extern uint16_t hostDnsPort;
+
+enum class DNSReplyCode { NoError = 0 };
+
+class DNSServer {
+private:
+  int fd = -1;
+  IPAddress ip;
+
+public:
+  void setErrorReplyCode(DNSReplyCode) {}
+
+  bool start(uint16_t, const char*, IPAddress address) {
+    ip = address;
+    if (!hostDnsPort) return true;
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return false;
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(hostDnsPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { close(fd); fd = -1; return false; }
+    return true;
+  }
+
+  // Answers one waiting query, if any: the header and question echoed back
+  // with one A record for ip.
+  void processNextRequest() {
+    if (fd < 0) return;
+    uint8_t packet[512];
+    sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    ssize_t n = recvfrom(fd, packet, sizeof(packet) - 16, 0, (sockaddr*)&from, &fromLen);
+    if (n < 12 || (packet[2] & 0x80)) return;  // Too short, or not a query
+    packet[2] = 0x84 | (packet[2] & 0x01);      // Response, authoritative, recursion as asked
+    packet[3] = 0x80;
+    packet[6] = 0; packet[7] = 1;                // One answer
+    packet[8] = packet[9] = packet[10] = packet[11] = 0;
+    const uint8_t answer[16] = {0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0, 60, 0, 4,
+                                ip.octets[0], ip.octets[1], ip.octets[2], ip.octets[3]};
+    memcpy(packet + n, answer, sizeof(answer));
+    sendto(fd, packet, n + sizeof(answer), 0, (sockaddr*)&from, fromLen);
+  }
+};
+
+#endif
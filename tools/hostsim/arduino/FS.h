@@ -0,0 +1,85 @@
+#ifndef HOSTSIM_FS_H
+#define HOSTSIM_FS_H
+
+// SPIFFS-style flat file system backed by a host directory (hostDataDir).
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include "Arduino.h"
+
+extern std::string hostDataDir;
+
+namespace fs {
+
+enum SeekMode { SeekSet, SeekCur, SeekEnd };
+
+class File : public Stream {
+private:
+  FILE* f;
+  DIR* d;
+  std::string fileName;
+
+public:
+  File() : f(nullptr), d(nullptr) {}
+  File(FILE* file, DIR* dir, const std::string& name) : f(file), d(dir), fileName(name) {}
+
+  operator bool() const { return f || d; }
+  bool isDirectory() const { return d != nullptr; }
+  const char* name() const { return fileName.c_str(); }
+
+  size_t size() const {
+    struct stat st;
+    return f && fstat(fileno(f), &st) == 0 ? (size_t)st.st_size : 0;
+  }
+  int available() override { return f ? (int)(size() - ftell(f)) : 0; }
+  size_t read(uint8_t* buf, size_t len) { return f ? fread(buf, 1, len, f) : 0; }
+  size_t write(const uint8_t* data, size_t len) override { return f ? fwrite(data, 1, len, f) : 0; }
+  using Print::write;
+  bool seek(uint32_t pos, SeekMode mode = SeekSet) {
+    return f && fseek(f, pos, mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END) == 0;
+  }
+
+  // SPIFFS has no directories: every entry is a "/name" file.
+  File openNextFile() {
+    if (!d) return File();
+    while (struct dirent* e = readdir(d)) {
+      if (e->d_name[0] == '.') continue;
+      FILE* file = fopen((hostDataDir + "/" + e->d_name).c_str(), "rb");
+      if (file) return File(file, nullptr, std::string("/") + e->d_name);
+    }
+    return File();
+  }
+
+  void close() {
+    if (f) fclose(f);
+    if (d) closedir(d);
+    f = nullptr;
+    d = nullptr;
+  }
+};
+
+class FS {
+public:
+  File open(const char* path, const char* mode = "r") {
+    std::string full = hostDataDir + path;
+    if (strcmp(mode, "r") == 0) {
+      struct stat st;
+      if (stat(full.c_str(), &st) != 0) return File();
+      if (S_ISDIR(st.st_mode)) return File(nullptr, opendir(full.c_str()), path);
+    }
+    FILE* f = fopen(full.c_str(), strcmp(mode, "r") == 0 ? "rb" : strcmp(mode, "w") == 0 ? "wb" : "ab");
+    return f ? File(f, nullptr, path) : File();
+  }
+  File open(const String& path, const char* mode = "r") { return open(path.c_str(), mode); }
+  bool exists(const char* path) {
+    struct stat st;
+    return stat((hostDataDir + path).c_str(), &st) == 0;
+  }
+  bool exists(const String& path) { return exists(path.c_str()); }
+};
+
+}  // namespace fs
+
+using fs::File;
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef HOSTSIM_SPIFFS_H
+#define HOSTSIM_SPIFFS_H
+
+#include "FS.h"
+
+class SPIFFSFS : public fs::FS {
+public:
+  bool begin(bool formatOnFail = false) { (void)formatOnFail; return true; }
+};
+
+extern SPIFFSFS SPIFFS;
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HOSTSIM_WIFI_H
+#define HOSTSIM_WIFI_H
+
+// No radio on the host: the access point is the machine's own network.
+
+#include "Arduino.h"
+
+#define WIFI_AP 2
+
+struct IPAddress {
+  uint8_t octets[4];
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) { octets[0] = a; octets[1] = b; octets[2] = c; octets[3] = d; }
+};
+
+struct WiFiClass {
+  void mode(int) {}
+  bool softAP(const char*, const char*) { return true; }
+  IPAddress softAPIP() { return IPAddress(127, 0, 0, 1); }
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,444 @@
+// bench: load test for the portal firmware.
+//
+// Boots the firmware in this process (setup() and its server tasks, content
+// read from a directory through the SPIFFS shim), then runs N client threads
+// against it over loopback for a while and prints one JSON object:
+// requests/s, latency percentiles, bytes and heap allocations per request,
+// and how many requests were turned away with 503.
+//
+//   bench [-c clients] [-d seconds] [-w warmup] [-m mix] [-t think_ms] [-n dns_ms] [-z] [-1] [-v] data/
+//
+// -m is a weighted list of what a client does next, e.g. browse=6,lesson=3,quiz=1:
+//   browse  / -> a module -> each of its lessons -> its quiz
+//   lesson  one random lesson      quiz  one random quiz
+//   module  one random module page
+//   root    the module list        static  the stylesheet
+//   probe   an OS connectivity check (/generate_204, /hotspot-detect.html...)
+// -t waits up to think_ms between requests, -z asks for gzip, -1 opens a new
+// connection per request instead of keeping it alive, -v shows the
+// firmware's log on stderr. Allocations count only the server's threads.
+// -n also sends the captive-portal DNS (on port HTTP_PORT + 1) a query
+// every dns_ms and reports how long replies take under the HTTP load; a
+// query unanswered after a second counts as lost.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Arduino.h"
+#include "content_parser.h"
+
+extern std::string hostDataDir;
+extern uint16_t hostDnsPort;
+extern ContentParser contentParser;
+void setup();
+void loop();
+
+// Heap allocations, counted by wrapping glibc's allocator. Threads of the
+// load generator mark themselves so only the firmware's work is counted.
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+static std::atomic<uint64_t> allocations(0);
+static thread_local bool loadThread = false;
+
+extern "C" void* malloc(size_t n) {
+  if (!loadThread) allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(n);
+}
+extern "C" void* calloc(size_t n, size_t size) {
+  if (!loadThread) allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_calloc(n, size);
+}
+extern "C" void* realloc(void* p, size_t n) {
+  if (!loadThread) allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_realloc(p, n);
+}
+
+enum Scenario { SCENARIO_BROWSE, SCENARIO_LESSON, SCENARIO_QUIZ, SCENARIO_ROOT, SCENARIO_STATIC, SCENARIO_PROBE, SCENARIO_MODULE, SCENARIO_COUNT };
+static const char* scenarioNames[SCENARIO_COUNT] = { "browse", "lesson", "quiz", "root", "static", "probe", "module" };
+static const char* probePaths[] = { "/generate_204", "/hotspot-detect.html", "/connecttest.txt", "/ncsi.txt" };
+
+struct SiteModule {
+  std::string id;
+  std::vector<int> lessons;
+  bool quiz;
+};
+
+struct ClientStats {
+  std::vector<uint32_t> micros;  // Latency of each measured request
+  uint64_t bytes = 0;
+  uint32_t errors = 0;
+  uint32_t shed = 0;  // 503 Service Unavailable: turned away by admission control
+  uint32_t connects = 0;
+};
+
+static std::vector<SiteModule> site;
+static std::string stylesheet;
+static int weights[SCENARIO_COUNT] = { 1, 0, 0, 0, 0, 0, 0 };
+static int thinkMs = 0;
+static bool gzip = false;
+static bool keepAlive = true;
+static std::atomic<bool> measuring(false);
+static std::atomic<bool> stopping(false);
+
+static uint64_t nowMicros() {
+  using namespace std::chrono;
+  return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// One client connection with a receive buffer; a browser tab, roughly.
+class HttpClient {
+private:
+  int fd = -1;
+  std::string in;
+  ClientStats& stats;
+
+  bool connectToPortal() {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(HTTP_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { disconnect(); return false; }
+    stats.connects++;
+    return true;
+  }
+
+  // Appends whatever the socket has to in; false at end of stream or error.
+  bool fill() {
+    char buf[16384];
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) return false;
+    in.append(buf, n);
+    return true;
+  }
+
+  bool readLine(size_t& pos, std::string& line) {
+    size_t end;
+    while ((end = in.find("\r\n", pos)) == std::string::npos) if (!fill()) return false;
+    line = in.substr(pos, end - pos);
+    pos = end + 2;
+    return true;
+  }
+
+  bool readBytes(size_t pos, size_t n) {
+    while (in.size() < pos + n) if (!fill()) return false;
+    return true;
+  }
+
+  static bool headerIs(const std::string& head, const char* name, const char* value) {
+    std::string needle = std::string("\r\n") + name + ": " + value;
+    return strcasestr(head.c_str(), needle.c_str()) != nullptr;
+  }
+
+  // Reads one response; returns its status, 0 on a broken stream. *body
+  // gets the body when the caller wants it.
+  int readResponse(size_t& total, std::string* body) {
+    size_t headEnd;
+    while ((headEnd = in.find("\r\n\r\n")) == std::string::npos) if (!fill()) return 0;
+    std::string head = in.substr(0, headEnd + 2);
+    int status = head.size() > 12 ? atoi(head.c_str() + 9) : 0;
+    size_t pos = headEnd + 4;
+    bool closes = headerIs(head, "Connection", "close");
+    const char* length = strcasestr(head.c_str(), "\r\nContent-Length:");
+    if (headerIs(head, "Transfer-Encoding", "chunked")) {
+      std::string line;
+      while (true) {
+        if (!readLine(pos, line)) return 0;
+        size_t n = strtoul(line.c_str(), nullptr, 16);
+        if (!readBytes(pos, n + 2)) return 0;
+        if (body) body->append(in, pos, n);
+        pos += n + 2;
+        if (n == 0) break;
+      }
+    } else if (length) {
+      size_t n = strtoul(length + 17, nullptr, 10);
+      if (!readBytes(pos, n)) return 0;
+      if (body) body->append(in, pos, n);
+      pos += n;
+    } else {
+      while (fill()) {}
+      if (body) body->append(in, pos, std::string::npos);
+      pos = in.size();
+      closes = true;
+    }
+    total = pos;
+    in.erase(0, pos);
+    if (closes || !keepAlive) disconnect();
+    return status;
+  }
+
+public:
+  explicit HttpClient(ClientStats& s) : stats(s) {}
+  ~HttpClient() { disconnect(); }
+
+  void disconnect() {
+    if (fd >= 0) close(fd);
+    fd = -1;
+    in.clear();
+  }
+
+  // GETs path; a kept-alive connection the server closed meanwhile is
+  // reopened once, as browsers do.
+  int get(const std::string& path, std::string* body = nullptr) {
+    std::string req = "GET " + path + " HTTP/1.1\r\nHost: portal\r\n";
+    if (gzip) req += "Accept-Encoding: gzip\r\n";
+    if (!keepAlive) req += "Connection: close\r\n";
+    req += "\r\n";
+    for (int attempt = 0; attempt < 2; attempt++) {
+      bool reused = fd >= 0;
+      if (fd < 0 && !connectToPortal()) break;
+      uint64_t start = nowMicros();
+      size_t bytes = 0;
+      int status = 0;
+      if (send(fd, req.data(), req.size(), MSG_NOSIGNAL) == (ssize_t)req.size()) status = readResponse(bytes, body);
+      if (status == 0) {
+        disconnect();
+        if (reused) continue;
+        break;
+      }
+      if (measuring) {
+        stats.micros.push_back((uint32_t)(nowMicros() - start));
+        stats.bytes += bytes;
+        if (status == 503) stats.shed++;
+        else if (status >= 400) stats.errors++;
+      }
+      return status;
+    }
+    if (measuring) stats.errors++;
+    return 0;
+  }
+};
+
+static Scenario pickScenario(std::mt19937& rng) {
+  int total = 0;
+  for (int i = 0; i < SCENARIO_COUNT; i++) total += weights[i];
+  int r = std::uniform_int_distribution<int>(0, total - 1)(rng);
+  for (int i = 0; i < SCENARIO_COUNT; i++) {
+    if (r < weights[i]) return (Scenario)i;
+    r -= weights[i];
+  }
+  return SCENARIO_ROOT;
+}
+
+static void think(std::mt19937& rng) {
+  if (thinkMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(std::uniform_int_distribution<int>(0, thinkMs)(rng)));
+}
+
+// The first page of a new attempt, where the board's redirect from
+// /quiz?module=... would land.
+static std::string quizPath(const SiteModule& m, std::mt19937& rng) {
+  return "/quiz?module=" + m.id + "&seed=" + std::to_string(std::uniform_int_distribution<int>(1, 0x7FFFFFFF)(rng));
+}
+
+static void runClient(int index, ClientStats* stats) {
+  loadThread = true;
+  std::mt19937 rng(index + 1);
+  HttpClient client(*stats);
+  while (!stopping) {
+    const SiteModule& m = site[std::uniform_int_distribution<size_t>(0, site.size() - 1)(rng)];
+    std::vector<std::string> paths;
+    switch (pickScenario(rng)) {
+      case SCENARIO_BROWSE:
+        paths.push_back("/");
+        paths.push_back("/module?id=" + m.id);
+        for (int id : m.lessons) paths.push_back("/lesson?module=" + m.id + "&lesson=" + std::to_string(id));
+        if (m.quiz) paths.push_back(quizPath(m, rng));
+        break;
+      case SCENARIO_LESSON:
+        if (m.lessons.empty()) paths.push_back("/module?id=" + m.id);
+        else paths.push_back("/lesson?module=" + m.id + "&lesson=" +
+                             std::to_string(m.lessons[std::uniform_int_distribution<size_t>(0, m.lessons.size() - 1)(rng)]));
+        break;
+      case SCENARIO_QUIZ: paths.push_back(m.quiz ? quizPath(m, rng) : "/module?id=" + m.id); break;
+      case SCENARIO_ROOT: paths.push_back("/"); break;
+      case SCENARIO_STATIC: paths.push_back(stylesheet); break;
+      case SCENARIO_MODULE: paths.push_back("/module?id=" + m.id); break;
+      default: paths.push_back(probePaths[std::uniform_int_distribution<int>(0, 3)(rng)]); break;
+    }
+    for (const std::string& path : paths) {
+      if (stopping) break;
+      client.get(path);
+      think(rng);
+    }
+  }
+}
+
+static bool parseMix(const char* spec) {
+  for (int i = 0; i < SCENARIO_COUNT; i++) weights[i] = 0;
+  int total = 0;
+  std::string s(spec);
+  size_t pos = 0;
+  while (pos < s.size()) {
+    size_t comma = s.find(',', pos);
+    if (comma == std::string::npos) comma = s.size();
+    std::string item = s.substr(pos, comma - pos);
+    size_t eq = item.find('=');
+    std::string name = item.substr(0, eq);
+    int weight = eq == std::string::npos ? 1 : atoi(item.c_str() + eq + 1);
+    int i = 0;
+    while (i < SCENARIO_COUNT && name != scenarioNames[i]) i++;
+    if (i == SCENARIO_COUNT || weight < 0) return false;
+    weights[i] = weight;
+    total += weight;
+    pos = comma + 1;
+  }
+  return total > 0;
+}
+
+// Queries the portal's DNS every intervalMs until stopped, one at a time,
+// recording reply latencies while measuring.
+static void runDnsProbe(int intervalMs, std::vector<uint32_t>* micros, uint32_t* lost) {
+  loadThread = true;
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  timeval tv = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(hostDnsPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  // A standard query for the A record of connectivitycheck.gstatic.com
+  static const char question[] = "\021connectivitycheck" "\007gstatic" "\003com" "\0\0\001\0\001";
+  uint8_t query[64] = {0, 0, 0x01, 0, 0, 1, 0, 0, 0, 0, 0, 0};
+  memcpy(query + 12, question, sizeof(question) - 1);
+  size_t queryLen = 12 + sizeof(question) - 1;
+  for (uint16_t id = 1; !stopping; id++) {
+    query[0] = id >> 8;
+    query[1] = id & 0xFF;
+    uint64_t start = nowMicros();
+    sendto(fd, query, queryLen, 0, (sockaddr*)&addr, sizeof(addr));
+    uint8_t reply[512];
+    ssize_t n;
+    while ((n = recv(fd, reply, sizeof(reply), 0)) >= 2 && (reply[0] != query[0] || reply[1] != query[1])) {}
+    if (measuring) {
+      if (n >= 12) micros->push_back((uint32_t)(nowMicros() - start));
+      else (*lost)++;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+  }
+  close(fd);
+}
+
+static double percentile(const std::vector<uint32_t>& sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+  return sorted[i] / 1000.0;
+}
+
+int main(int argc, char** argv) {
+  const char* usage = "usage: bench [-c clients] [-d seconds] [-w warmup] [-m mix] [-t think_ms] [-n dns_ms] [-z] [-1] [-v] data_dir\n";
+  int clients = 8;
+  double seconds = 10;
+  double warmup = 1;
+  const char* mix = "browse";
+  bool verbose = false;
+  int dnsMs = 0;
+  std::string dataDir;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-c") && i + 1 < argc) clients = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-d") && i + 1 < argc) seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-w") && i + 1 < argc) warmup = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-m") && i + 1 < argc) mix = argv[++i];
+    else if (!strcmp(argv[i], "-t") && i + 1 < argc) thinkMs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-n") && i + 1 < argc) dnsMs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-z")) gzip = true;
+    else if (!strcmp(argv[i], "-1")) keepAlive = false;
+    else if (!strcmp(argv[i], "-v")) verbose = true;
+    else if (argv[i][0] != '-') dataDir = argv[i];
+    else { fprintf(stderr, "%s", usage); return 2; }
+  }
+  if (dataDir.empty() || clients < 1 || seconds <= 0 || !parseMix(mix)) { fprintf(stderr, "%s", usage); return 2; }
+
+  hostDataDir = dataDir;
+  hostSerialOut = verbose ? stderr : nullptr;
+  if (dnsMs > 0) hostDnsPort = HTTP_PORT + 1;
+  setup();
+  std::thread([] { for (;;) loop(); }).detach();
+  loadThread = true;
+
+  for (int i = 0; i < contentParser.getModuleCount(); i++) {
+    const Module* m = contentParser.getModule(i);
+    SiteModule sm;
+    sm.id.assign(m->id.ptr, m->id.len);
+    for (int j = 0; j < m->lessonCount; j++) sm.lessons.push_back(contentParser.getLesson(*m, j).id);
+    sm.quiz = m->hasQuiz();
+    site.push_back(sm);
+  }
+  if (site.empty()) { fprintf(stderr, "bench: no modules in %s\n", dataDir.c_str()); return 1; }
+  {
+    ClientStats probeStats;
+    HttpClient probe(probeStats);
+    std::string root;
+    if (probe.get("/", &root) != 200) { fprintf(stderr, "bench: portal not answering on port %d\n", HTTP_PORT); return 1; }
+    size_t href = root.find("stylesheet' href='");
+    if (href != std::string::npos) stylesheet = root.substr(href + 18, root.find('\'', href + 18) - href - 18);
+    if (stylesheet.empty()) stylesheet = "/";
+  }
+
+  std::vector<ClientStats> stats(clients);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < clients; i++) {
+    stats[i].micros.reserve(1 << 16);
+    threads.push_back(std::thread(runClient, i, &stats[i]));
+  }
+  std::vector<uint32_t> dnsMicros;
+  uint32_t dnsLost = 0;
+  if (dnsMs > 0) threads.push_back(std::thread(runDnsProbe, dnsMs, &dnsMicros, &dnsLost));
+  std::this_thread::sleep_for(std::chrono::milliseconds((int)(warmup * 1000)));
+  uint64_t allocStart = allocations.load();
+  uint64_t start = nowMicros();
+  measuring = true;
+  std::this_thread::sleep_for(std::chrono::milliseconds((int)(seconds * 1000)));
+  measuring = false;
+  double elapsed = (nowMicros() - start) / 1e6;
+  uint64_t allocCount = allocations.load() - allocStart;
+  stopping = true;
+  for (std::thread& t : threads) t.join();
+
+  std::vector<uint32_t> all;
+  uint64_t bytes = 0;
+  uint32_t errors = 0, shed = 0, connects = 0;
+  for (const ClientStats& s : stats) {
+    all.insert(all.end(), s.micros.begin(), s.micros.end());
+    bytes += s.bytes;
+    errors += s.errors;
+    shed += s.shed;
+    connects += s.connects;
+  }
+  std::sort(all.begin(), all.end());
+  size_t n = all.size();
+  printf("{\"clients\":%d,\"seconds\":%.2f,\"mix\":\"%s\",\"keep_alive\":%s,\"gzip\":%s,\"think_ms\":%d,"
+         "\"requests\":%zu,\"errors\":%u,\"shed\":%u,\"connections\":%u,\"requests_per_s\":%.1f,"
+         "\"latency_ms\":{\"p50\":%.3f,\"p95\":%.3f,\"p99\":%.3f,\"max\":%.3f},"
+         "\"bytes_per_request\":%.1f,\"allocs_per_request\":%.2f",
+         clients, elapsed, mix, keepAlive ? "true" : "false", gzip ? "true" : "false", thinkMs,
+         n, errors, shed, connects, n / elapsed,
+         percentile(all, 0.50), percentile(all, 0.95), percentile(all, 0.99), n ? all[n - 1] / 1000.0 : 0.0,
+         n ? (double)bytes / n : 0.0, n ? (double)allocCount / n : 0.0);
+  if (dnsMs > 0) {
+    std::sort(dnsMicros.begin(), dnsMicros.end());
+    size_t d = dnsMicros.size();
+    printf(",\"dns\":{\"queries\":%zu,\"lost\":%u,\"p50\":%.3f,\"p99\":%.3f,\"max\":%.3f}",
+           d + dnsLost, dnsLost, percentile(dnsMicros, 0.50), percentile(dnsMicros, 0.99), d ? dnsMicros[d - 1] / 1000.0 : 0.0);
+  }
+  printf("}\n");
+  fflush(stdout);
+  _exit(errors > 0 || dnsLost > 0 ? 1 : 0);  // The server tasks never return
+}
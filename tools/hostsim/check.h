@@ -0,0 +1,25 @@
+#ifndef HOSTSIM_CHECK_H
+#define HOSTSIM_CHECK_H
+
+// The few lines the host tests share: CHECK() reports a failed condition
+// with its place and carries on, and checkResult() is main()'s exit status.
+
+#include <stdio.h>
+
+static int checkFailures = 0;
+
+#define CHECK(cond)                                                         \
+  do {                                                                      \
+    if (!(cond)) {                                                          \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      checkFailures++;                                                      \
+    }                                                                       \
+  } while (0)
+
+inline int checkResult(const char* name) {
+  if (checkFailures) fprintf(stderr, "%s: %d check(s) failed\n", name, checkFailures);
+  else printf("%s: ok\n", name);
+  return checkFailures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,14 @@
+// Globals of the Arduino shims.
+#include "Arduino.h"
+#include "DNSServer.h"
+#include "SPIFFS.h"
+#include "WiFi.h"
+
+FILE* hostSerialOut = stdout;
+std::string hostDataDir = "data";
+uint16_t hostDnsPort = 0;
+
+HardwareSerial Serial;
+EspClass ESP;
+SPIFFSFS SPIFFS;
+WiFiClass WiFi;
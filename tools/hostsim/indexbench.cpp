@@ -0,0 +1,145 @@
+// indexbench: route lookup micro-benchmark for the content model.
+//
+// Writes a synthetic content directory (by default 1000 modules of 100
+// lessons, one tiny file each), loads it with the firmware's ContentParser
+// and prints the boot profile, whose "index" phase is finishLoad() and
+// buildIndexes(). It then boots a second parser from the manifest that first
+// scan wrote and prints that profile too, the cost of every later boot. Then times getModuleById() and findLesson() on ids drawn
+// from a fixed seed, next to the linear scan they replaced, in ns per call.
+//
+//   indexbench [-m modules] [-l lessons] [-n lookups]
+//
+// The directory is made under /tmp and removed again afterwards.
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "content_parser.h"
+
+extern std::string hostDataDir;
+
+struct StdoutPrinter {
+  void print(const char* s) { fputs(s, stdout); }
+};
+
+static double nowSeconds() {
+  using namespace std::chrono;
+  return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+static bool writeCorpus(const std::string& dir, int modules, int lessons) {
+  char name[96];
+  for (int m = 0; m < modules; m++) {
+    for (int l = 1; l <= lessons; l++) {
+      snprintf(name, sizeof(name), "%s/mod%04d_%d.lesson.content", dir.c_str(), m, l);
+      FILE* f = fopen(name, "w");
+      if (!f) return false;
+      fprintf(f, "# Lesson %d of module %d\n\nText.\n", l, m);
+      fclose(f);
+    }
+  }
+  return true;
+}
+
+static void removeCorpus(const std::string& dir) {
+  if (DIR* d = opendir(dir.c_str())) {
+    while (dirent* e = readdir(d)) {
+      if (e->d_name[0] != '.') unlink((dir + "/" + e->d_name).c_str());
+    }
+    closedir(d);
+  }
+  rmdir(dir.c_str());
+}
+
+// Times lookups calls of fn(i) and prints ns per call; fn returns whether it
+// found what it looked for, so the compiler cannot drop the work.
+template <typename Fn>
+static void timeLookups(const char* name, int lookups, Fn fn) {
+  int found = 0;
+  double start = nowSeconds();
+  for (int i = 0; i < lookups; i++) found += fn(i);
+  double seconds = nowSeconds() - start;
+  printf("%-26s %8.1f ns per call (%d of %d found)\n", name, seconds * 1e9 / lookups, found, lookups);
+}
+
+int main(int argc, char** argv) {
+  const char* usage = "usage: indexbench [-m modules] [-l lessons] [-n lookups]\n";
+  int modules = 1000, lessons = 100, lookups = 1000000;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-m") && i + 1 < argc) modules = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-l") && i + 1 < argc) lessons = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-n") && i + 1 < argc) lookups = atoi(argv[++i]);
+    else { fprintf(stderr, "%s", usage); return 2; }
+  }
+  if (modules < 1 || modules > 10000 || lessons < 1 || lessons > 0xFFFF || lookups < 1) { fprintf(stderr, "%s", usage); return 2; }
+
+  char dir[] = "/tmp/indexbench.XXXXXX";
+  if (!mkdtemp(dir)) { perror("indexbench"); return 1; }
+  if (!writeCorpus(dir, modules, lessons)) { perror("indexbench"); removeCorpus(dir); return 1; }
+
+  hostDataDir = dir;
+  hostSerialOut = nullptr;
+  ContentParser parser;
+  parser.initialize();
+  parser.loadModules();
+  ContentParser fromManifest;
+  fromManifest.initialize();
+  fromManifest.loadModules();
+  removeCorpus(dir);
+  StdoutPrinter out;
+  printf("boot from a scan:\n");
+  parser.getBootProfile().printTable(out);
+  printf("boot from the manifest:\n");
+  fromManifest.getBootProfile().printTable(out);
+  if (fromManifest.getModuleCount() != parser.getModuleCount()) { fprintf(stderr, "indexbench: manifest boot loaded %d modules\n", fromManifest.getModuleCount()); return 1; }
+  printf("%d modules, %d lessons each\n", parser.getModuleCount(), lessons);
+  if (parser.getModuleCount() != modules) { fprintf(stderr, "indexbench: loaded %d modules\n", parser.getModuleCount()); return 1; }
+
+  // What each lookup asks for, drawn up front; one in 16 is unknown
+  std::mt19937 rng(9);
+  std::vector<std::string> ids(4096);
+  std::vector<const Module*> owners(4096);
+  std::vector<int32_t> lessonIds(4096);
+  char id[32];
+  for (size_t i = 0; i < ids.size(); i++) {
+    bool miss = rng() % 16 == 0;
+    int m = (int)(rng() % modules);
+    snprintf(id, sizeof(id), miss ? "nomod%04d" : "mod%04d", m);
+    ids[i] = id;
+    owners[i] = parser.getModule(rng() % modules);
+    lessonIds[i] = miss ? lessons + 1 : 1 + (int32_t)(rng() % lessons);
+  }
+
+  timeLookups("getModuleById (index)", lookups, [&](int i) {
+    const std::string& s = ids[i & 4095];
+    return parser.getModuleById(TextSpan(s.data(), s.size())) != nullptr;
+  });
+  // The scan is slow enough that a hundredth of the calls gives a steady figure
+  timeLookups("module scan", lookups / 100 + 1, [&](int i) {
+    const std::string& s = ids[i & 4095];
+    for (int m = 0; m < parser.getModuleCount(); m++) {
+      const Module& mod = *parser.getModule(m);
+      if (mod.id.len == s.size() && memcmp(mod.id.ptr, s.data(), s.size()) == 0) return true;
+    }
+    return false;
+  });
+  timeLookups("findLesson (slots)", lookups, [&](int i) {
+    return parser.findLesson(*owners[i & 4095], lessonIds[i & 4095]) != nullptr;
+  });
+  timeLookups("lesson scan", lookups, [&](int i) {
+    const Module& m = *owners[i & 4095];
+    for (int j = 0; j < m.lessonCount; j++) {
+      if (parser.getLesson(m, j).id == lessonIds[i & 4095]) return true;
+    }
+    return false;
+  });
+  return 0;
+}
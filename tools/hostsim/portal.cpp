@@ -0,0 +1,13 @@
+// Runs the portal firmware on the host, serving a content directory:
+//   tools/hostsim/portal data     then open http://localhost:8080/
+#include "Arduino.h"
+
+extern std::string hostDataDir;
+void setup();
+void loop();
+
+int main(int argc, char** argv) {
+  if (argc > 1) hostDataDir = argv[1];
+  setup();
+  for (;;) loop();
+}
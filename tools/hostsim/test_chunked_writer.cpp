@@ -0,0 +1,99 @@
+// test_chunked_writer: writes pieces of every awkward size through a
+// ChunkedWriter into a sink that records each chunk, and checks that no
+// chunk is empty or over HTML_CHUNK_SIZE, that only flush() and the end
+// leave a short one, and that the bytes arrive unchanged and ended once.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "check.h"
+#include "chunked_writer.h"
+
+struct MockSink {
+  std::vector<std::string> chunks;
+  int ends = 0;
+
+  static void receive(const char* data, size_t len, void* ctx) {
+    MockSink* sink = (MockSink*)ctx;
+    CHECK(sink->ends == 0);  // nothing after the end
+    if (len == 0) sink->ends++;
+    else sink->chunks.push_back(std::string(data, len));
+  }
+
+  std::string joined() const {
+    std::string all;
+    for (const std::string& c : chunks) all += c;
+    return all;
+  }
+};
+
+// Every chunk but the last is full, and none is over the buffer.
+static void checkChunks(const MockSink& sink) {
+  for (size_t i = 0; i < sink.chunks.size(); i++) {
+    CHECK(sink.chunks[i].size() <= HTML_CHUNK_SIZE);
+    if (i + 1 < sink.chunks.size()) CHECK(sink.chunks[i].size() == HTML_CHUNK_SIZE);
+  }
+}
+
+int main() {
+  std::mt19937 rng(3);
+  const size_t sizes[] = { 0, 1, HTML_CHUNK_SIZE - 1, HTML_CHUNK_SIZE, HTML_CHUNK_SIZE + 1, 2 * HTML_CHUNK_SIZE, 5000 };
+
+  // Single writes of the sizes around the buffer, from an empty buffer and
+  // from one that is already part full
+  for (size_t lead : { (size_t)0, (size_t)1, (size_t)HTML_CHUNK_SIZE - 1 }) {
+    for (size_t n : sizes) {
+      MockSink sink;
+      ChunkedWriter out(MockSink::receive, &sink);
+      std::string expected(lead, 'L');
+      for (size_t i = 0; i < n; i++) expected += (char)('a' + i % 26);
+      out.write(expected.data(), lead);
+      out.write(expected.data() + lead, n);
+      out.finish();
+      checkChunks(sink);
+      CHECK(sink.ends == 1);
+      CHECK(sink.joined() == expected);
+      CHECK(out.bytesWritten() == expected.size());
+      CHECK(sink.chunks.size() == (expected.size() + HTML_CHUNK_SIZE - 1) / HTML_CHUNK_SIZE);
+    }
+  }
+
+  // Random pieces, as templates and md_html() produce them
+  for (int run = 0; run < 200; run++) {
+    MockSink sink;
+    ChunkedWriter out(MockSink::receive, &sink);
+    std::string expected;
+    int pieces = 1 + rng() % 300;
+    for (int p = 0; p < pieces; p++) {
+      size_t n = rng() % 4 == 0 ? rng() % (3 * HTML_CHUNK_SIZE) : rng() % 40;
+      std::string piece(n, (char)('A' + p % 26));
+      if (p % 3 == 0) out.write(String(piece));
+      else out.write(piece.data(), piece.size());
+      expected += piece;
+    }
+    out.finish();
+    checkChunks(sink);
+    CHECK(sink.ends == 1);
+    CHECK(sink.joined() == expected);
+    CHECK(out.bytesWritten() == expected.size());
+  }
+
+  // flush() may send a short chunk mid-page, but never an empty one
+  MockSink sink;
+  ChunkedWriter out(MockSink::receive, &sink);
+  out.write("head");
+  out.flush();
+  out.flush();
+  out.write(std::string(HTML_CHUNK_SIZE + 7, 'x').c_str());
+  out.finish();
+  CHECK(sink.chunks.size() == 3);
+  CHECK(sink.chunks[0] == "head");
+  CHECK(sink.chunks[1].size() == HTML_CHUNK_SIZE);
+  CHECK(sink.chunks[2].size() == 7);
+  CHECK(sink.ends == 1);
+  for (const std::string& c : sink.chunks) CHECK(!c.empty() && c.size() <= HTML_CHUNK_SIZE);
+
+  return checkResult("test_chunked_writer");
+}
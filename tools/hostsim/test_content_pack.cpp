@@ -0,0 +1,135 @@
+// test_content_pack: boots a ContentParser from a content pack, then edits
+// the pack's quiz without changing its question count and reloads: the
+// module's quiz hash follows the quiz source, so its stats key changes and
+// the counters start over, as they do when booting from the raw files.
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "check.h"
+#include "content_parser.h"
+#include "quiz_stats.h"
+
+extern std::string hostDataDir;
+
+// Writes /content.pack with one module, "geo", holding quiz alone, laid out
+// as contentc lays it out.
+static bool writePack(const std::string& dir, const std::string& quiz) {
+  std::string pool = "geoGeo";
+  std::vector<PackQuestion> questions;
+  std::string blocks;
+  QuizReader reader(quiz.data(), quiz.size());
+  QuizQuestionSpans q;
+  char block[QUIZ_BLOCK_MAX];
+  while (reader.next(q)) {
+    PackQuestion pq;
+    pq.blockLength = (uint16_t)quizBlockEncode(q, block, sizeof(block));
+    pq.blockOffset = (uint32_t)blocks.size();  // made absolute below
+    pq.optionCount = (uint8_t)q.optionCount;
+    pq.answer = (uint8_t)(q.correctAnswer - 'a');
+    questions.push_back(pq);
+    blocks.append(block, pq.blockLength);
+  }
+
+  PackHeader h;
+  memset(&h, 0, sizeof(h));
+  h.magic = CONTENT_PACK_MAGIC;
+  h.version = CONTENT_PACK_VERSION;
+  h.moduleCount = 1;
+  h.questionCount = (uint16_t)questions.size();
+  h.stringPoolSize = (uint32_t)pool.size();
+  h.indexSize = (uint32_t)(packStringsOffset(h) + pool.size());
+  h.bodySize = (uint32_t)blocks.size();
+  for (PackQuestion& pq : questions) pq.blockOffset += h.indexSize;
+
+  PackModule m;
+  memset(&m, 0, sizeof(m));
+  m.id = PackStr{0, 3};
+  m.name = PackStr{3, 3};
+  m.questionCount = h.questionCount;
+  m.quizHash = contentHash(quiz.data(), quiz.size());
+
+  FILE* f = fopen((dir + CONTENT_PACK_PATH).c_str(), "wb");
+  if (!f) return false;
+  fwrite(&h, sizeof(h), 1, f);
+  fwrite(&m, sizeof(m), 1, f);
+  fwrite(questions.data(), sizeof(PackQuestion), questions.size(), f);
+  fwrite(pool.data(), 1, pool.size(), f);
+  fwrite(blocks.data(), 1, blocks.size(), f);
+  return fclose(f) == 0;
+}
+
+static void removeDir(const std::string& dir) {
+  if (DIR* d = opendir(dir.c_str())) {
+    while (dirent* e = readdir(d)) {
+      if (e->d_name[0] != '.') unlink((dir + "/" + e->d_name).c_str());
+    }
+    closedir(d);
+  }
+  rmdir(dir.c_str());
+}
+
+static const char* QUIZ =
+    "# Geography\n\n---\n\n"
+    "### Question 1\nLargest island?\n\na) Cebu\nb) Luzon\nc) Samar\n\n**Answer: b**\n\n---\n\n"
+    "### Question 2\nCapital?\n\na) Manila\nb) Davao\n\n**Answer: a**\n";
+
+// The same two questions, the first with a fourth option
+static const char* EDITED_QUIZ =
+    "# Geography\n\n---\n\n"
+    "### Question 1\nLargest island?\n\na) Cebu\nb) Luzon\nc) Samar\nd) Mindanao\n\n**Answer: b**\n\n---\n\n"
+    "### Question 2\nCapital?\n\na) Manila\nb) Davao\n\n**Answer: a**\n";
+
+int main() {
+  char dir[] = "/tmp/test_content_pack.XXXXXX";
+  if (!mkdtemp(dir)) { perror("test_content_pack"); return 1; }
+  hostDataDir = dir;
+  hostSerialOut = nullptr;
+
+  CHECK(writePack(dir, QUIZ));
+  ContentParser parser;
+  parser.initialize();
+  parser.loadModules();
+  const Module* m = parser.getModuleById(TextSpan("geo", 3));
+  CHECK(m != nullptr);
+  if (!m) { removeDir(dir); return checkResult("test_content_pack"); }
+  CHECK(m->quizQuestionCount == 2);
+  CHECK(m->quizHash == contentHash(QUIZ, strlen(QUIZ)));
+
+  auto optionCounts = [&parser](const Module* mod) {
+    return [&parser, mod](uint16_t i) { return (int)parser.getQuestion(*mod, i).optionCount; };
+  };
+  QuizStatsTable stats;
+  uint32_t key = quizStatsKey(m->id, m->quizHash, m->quizQuestionCount);
+  QuizStats* s = stats.open(key, m->quizQuestionCount, optionCounts(m));
+  CHECK(s != nullptr && s->optionCount(0) == 3);
+  if (s) QuizStatsTable::record(*s, 0, 1, true);
+
+  // Same question count, different quiz: a new key, counters from zero
+  CHECK(writePack(dir, EDITED_QUIZ));
+  ReloadStats reload = parser.reloadModules();
+  CHECK(reload.full);
+  CHECK(reload.files == 1);  // The quiz; the pack has no lessons
+  m = parser.getModuleById(TextSpan("geo", 3));
+  CHECK(m != nullptr && m->quizQuestionCount == 2);
+  if (m) {
+    CHECK(m->quizHash == contentHash(EDITED_QUIZ, strlen(EDITED_QUIZ)));
+    uint32_t editedKey = quizStatsKey(m->id, m->quizHash, m->quizQuestionCount);
+    CHECK(editedKey != key);
+    CHECK(stats.find(editedKey) == nullptr);
+    QuizStats* edited = stats.open(editedKey, m->quizQuestionCount, optionCounts(m));
+    CHECK(edited != nullptr && edited != s);
+    if (edited) {
+      CHECK(edited->optionCount(0) == 4);
+      CHECK(edited->correct(0) == 0 && edited->picks(0)[1] == 0);
+    }
+  }
+
+  removeDir(dir);
+  return checkResult("test_content_pack");
+}
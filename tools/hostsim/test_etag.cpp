@@ -0,0 +1,31 @@
+// test_etag: If-None-Match matches the page's tag in any of the forms
+// clients send: alone, in a list, weak, or "*"; other tags, a tag cut
+// short or a comma inside a quoted tag do not match.
+
+#include "check.h"
+#include "http_server.h"
+
+static bool listed(const char* header, const char* tag) { return etagListed(TextSpan(header, strlen(header)), tag); }
+
+int main() {
+  const char* tag = "\"1a2b3c4d\"";
+  CHECK(listed("\"1a2b3c4d\"", tag));
+  CHECK(listed("W/\"1a2b3c4d\"", tag));
+  CHECK(listed("\"00000000\", \"1a2b3c4d\"", tag));
+  CHECK(listed("\"00000000\",W/\"1a2b3c4d\" , \"ffffffff\"", tag));
+  CHECK(listed("*", tag));
+  CHECK(listed(" * ", tag));
+
+  CHECK(!listed("", tag));
+  CHECK(!listed("\"00000000\"", tag));
+  CHECK(!listed("\"1a2b3c4d", tag));
+  CHECK(!listed("1a2b3c4d", tag));
+  CHECK(!listed("\"1a2b3c4d-gz\"", tag));
+  CHECK(!listed("w/\"1a2b3c4d\"", tag));  // The weak prefix is case-sensitive
+  CHECK(!listed("\"x,\"1a2b3c4d\"\"", tag));
+  CHECK(!listed(",,", tag));
+
+  // The gzip variant has its own tag
+  CHECK(listed("\"1a2b3c4d\", \"1a2b3c4d-gz\"", "\"1a2b3c4d-gz\""));
+  return checkResult("test_etag");
+}
@@ -0,0 +1,159 @@
+// test_http_engine: a client that stops reading holds only its own
+// connection. While one client sits on a large body (read from a body
+// source) and another on a large written response, a third keeps getting
+// answers without delay; both stalled responses then arrive whole.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "check.h"
+#include "http_engine.h"
+
+static const size_t SOURCE_BYTES = 4 << 20;                  // Far more than any socket buffers
+static const size_t WRITTEN_BYTES = HTTP_OUTPUT_MAX * 3 / 4;  // Past the window, under the cap
+
+static char patternByte(size_t i) { return (char)('a' + (i * 7 + i / 251) % 26); }
+
+struct PatternBody {
+  size_t offset;
+  static size_t read(void* ctx, char* buf, size_t cap) {
+    PatternBody& b = *(PatternBody*)ctx;
+    for (size_t i = 0; i < cap; i++) buf[i] = patternByte(b.offset + i);
+    b.offset += cap;
+    return cap;
+  }
+  static void close(void* ctx) { delete (PatternBody*)ctx; }
+};
+
+static int sourcesClosed = 0;
+
+static void writeHead(HttpOutput& out, size_t length) {
+  char head[96];
+  int n = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n\r\n", (unsigned)length);
+  out.write(head, n);
+}
+
+static void handle(HttpRequest& req, HttpOutput& out, void*) {
+  if (spanStartsWith(req.path, "/source")) {
+    writeHead(out, SOURCE_BYTES);
+    HttpBodySource body;
+    body.read = PatternBody::read;
+    body.close = [](void* ctx) { sourcesClosed++; PatternBody::close(ctx); };
+    body.ctx = new PatternBody{0};
+    body.remaining = SOURCE_BYTES;
+    out.setBody(body);
+  } else if (spanStartsWith(req.path, "/written")) {
+    writeHead(out, WRITTEN_BYTES);
+    char buf[1000];
+    for (size_t i = 0; i < WRITTEN_BYTES; i += sizeof(buf)) {
+      size_t n = WRITTEN_BYTES - i < sizeof(buf) ? WRITTEN_BYTES - i : sizeof(buf);
+      for (size_t j = 0; j < n; j++) buf[j] = patternByte(i + j);
+      out.write(buf, n);
+    }
+  } else {
+    writeHead(out, 2);
+    out.write("ok");
+  }
+}
+
+static int connectTo(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int small = 4096;  // Fill the window of a client that does not read quickly
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { close(fd); return -1; }
+  timeval tv = {5, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  return fd;
+}
+
+static void request(int fd, const char* path) {
+  std::string r = std::string("GET ") + path + " HTTP/1.1\r\nHost: test\r\n\r\n";
+  send(fd, r.data(), r.size(), MSG_NOSIGNAL);
+}
+
+// Reads one response and returns its body, or "" on error.
+static std::string readResponse(int fd) {
+  std::string in;
+  char buf[65536];
+  size_t headEnd = std::string::npos, length = 0;
+  while (headEnd == std::string::npos || in.size() < headEnd + 4 + length) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) return "";
+    in.append(buf, n);
+    if (headEnd == std::string::npos && (headEnd = in.find("\r\n\r\n")) != std::string::npos) {
+      size_t field = in.find("Content-Length: ");
+      length = field < headEnd ? strtoul(in.c_str() + field + 16, nullptr, 10) : 0;
+    }
+  }
+  return in.substr(headEnd + 4, length);
+}
+
+static bool isPattern(const std::string& body, size_t length) {
+  if (body.size() != length) return false;
+  for (size_t i = 0; i < length; i++) if (body[i] != patternByte(i)) return false;
+  return true;
+}
+
+int main() {
+  HttpEngine engine;
+  uint16_t port = 0;
+  for (int i = 0; i < 50 && !port; i++) {
+    uint16_t p = (uint16_t)(20000 + (getpid() * 7 + i * 131) % 20000);
+    if (engine.begin(p, handle, nullptr)) port = p;
+  }
+  if (!port) { fprintf(stderr, "test_http_engine: no free port\n"); return 1; }
+
+  std::atomic<bool> stop(false);
+  std::thread server([&] { while (!stop) engine.poll(5); });
+
+  int stalledSource = connectTo(port);
+  int stalledWritten = connectTo(port);
+  int quick = connectTo(port);
+  CHECK(stalledSource >= 0 && stalledWritten >= 0 && quick >= 0);
+  request(stalledSource, "/source");
+  request(stalledWritten, "/written");
+
+  // Neither stalled client reads; the quick one is answered at once, every time
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  double worstMs = 0;
+  for (int i = 0; i < 50; i++) {
+    auto start = std::chrono::steady_clock::now();
+    request(quick, "/quick");
+    CHECK(readResponse(quick) == "ok");
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (ms > worstMs) worstMs = ms;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  printf("quick requests while two clients stall: worst %.2f ms\n", worstMs);
+  CHECK(worstMs < 200);  // A handler waiting for a stalled client took up to 1 s
+
+  // Both stalled responses are complete once their clients read them
+  CHECK(isPattern(readResponse(stalledWritten), WRITTEN_BYTES));
+  CHECK(isPattern(readResponse(stalledSource), SOURCE_BYTES));
+  request(stalledSource, "/quick");
+  CHECK(readResponse(stalledSource) == "ok");  // and kept alive after it
+
+  close(stalledSource);
+  close(stalledWritten);
+  close(quick);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  stop = true;
+  server.join();
+
+  const HttpEngineStats& s = engine.getStats();
+  CHECK(sourcesClosed == 1);
+  CHECK(s.aborted == 0 && s.timedOut == 0);
+  printf("responses grown past the window: %u\n", (unsigned)s.overflows);  // Up to the socket buffers
+  return checkResult("test_http_engine");
+}
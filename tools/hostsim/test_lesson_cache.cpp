@@ -0,0 +1,130 @@
+// test_lesson_cache: replays a classroom-like access trace through the
+// LessonCache and checks its counters against a plain reference LRU, and
+// that the heap held by cached pages never goes past the byte budget.
+
+#include <cstddef>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "Arduino.h"
+#include "check.h"
+#include "lesson_cache.h"
+
+// Live heap bytes, counted through global new/delete, which String uses.
+static size_t liveBytes = 0;
+static size_t peakLiveBytes = 0;
+
+void* operator new(size_t n) {
+  size_t* p = (size_t*)malloc(n + sizeof(std::max_align_t));
+  if (!p) throw std::bad_alloc();
+  *p = n;
+  liveBytes += n;
+  if (liveBytes > peakLiveBytes) peakLiveBytes = liveBytes;
+  return (char*)p + sizeof(std::max_align_t);
+}
+void operator delete(void* q) noexcept {
+  if (!q) return;
+  size_t* p = (size_t*)((char*)q - sizeof(std::max_align_t));
+  liveBytes -= *p;
+  free(p);
+}
+void operator delete(void* q, size_t) noexcept { operator delete(q); }
+
+// What LessonCache promises, written the slow and obvious way.
+struct ReferenceLru {
+  struct Entry { uint32_t key; size_t bytes; };
+  std::vector<Entry> entries;  // least recently used first
+  size_t budget;
+  uint32_t hits = 0, misses = 0, evictions = 0;
+  size_t bytes = 0;
+
+  explicit ReferenceLru(size_t b) : budget(b) { entries.reserve(LESSON_CACHE_SLOTS + 1); }
+
+  bool get(uint32_t key) {
+    for (size_t i = 0; i < entries.size(); i++) {
+      if (entries[i].key != key) continue;
+      Entry e = entries[i];
+      entries.erase(entries.begin() + i);
+      entries.push_back(e);
+      hits++;
+      return true;
+    }
+    misses++;
+    return false;
+  }
+
+  void put(uint32_t key, size_t n) {
+    if (n > budget) return;
+    while (entries.size() >= LESSON_CACHE_SLOTS || bytes + n > budget) {
+      bytes -= entries.front().bytes;
+      entries.erase(entries.begin());
+      evictions++;
+    }
+    entries.push_back(Entry{key, n});
+    bytes += n;
+  }
+};
+
+int main() {
+  const size_t budget = LESSON_CACHE_BYTES;
+  const uint32_t lessons = 40;
+  std::mt19937 rng(20240611);
+
+  // Page sizes as rendered lessons run: mostly 1-5 KB, one over budget
+  std::vector<size_t> pageBytes(lessons);
+  for (uint32_t i = 0; i < lessons; i++) pageBytes[i] = 800 + rng() % 4500;
+  pageBytes[lessons - 1] = budget + 1;
+
+  ReferenceLru ref(budget);
+  size_t baseline = liveBytes;
+  {
+    LessonCache cache(budget);
+
+    // A class works through the lessons in order, a few students behind or
+    // ahead, with the odd jump back to an earlier one
+    for (uint32_t step = 0; step < 20000; step++) {
+      uint32_t front = (step / 400) % lessons;
+      uint32_t spread = rng() % 4;
+      uint32_t key = rng() % 10 == 0 ? rng() % lessons : (front + lessons - spread) % lessons;
+
+      bool refHit = ref.get(key);
+      const String* html = cache.get(key);
+      CHECK((html != nullptr) == refHit);
+      if (html) {
+        CHECK(html->length() == pageBytes[key]);
+      } else {
+        String page;
+        page.reserve(pageBytes[key]);
+        for (size_t i = 0; i < pageBytes[key]; i++) page += (char)('a' + key % 26);
+        bool fits = cache.put(key, page) != nullptr;
+        CHECK(fits == (pageBytes[key] <= budget));
+        ref.put(key, pageBytes[key]);
+      }
+      const LessonCacheStats& s = cache.getStats();
+      CHECK(s.bytes == ref.bytes);
+      CHECK(s.bytes <= budget);
+    }
+
+    const LessonCacheStats& s = cache.getStats();
+    CHECK(s.hits == ref.hits);
+    CHECK(s.misses == ref.misses);
+    CHECK(s.evictions == ref.evictions);
+    CHECK(s.hits + s.misses == 20000);
+    CHECK(s.hits > s.misses);
+    CHECK(s.peakBytes <= budget);
+
+    // The heap holds the cached pages plus the one being rendered, and a
+    // little per String for the terminator
+    size_t peakHeap = peakLiveBytes - baseline;
+    printf("hits %u misses %u evictions %u peak cached %u peak heap %u budget %u\n",
+           (unsigned)s.hits, (unsigned)s.misses, (unsigned)s.evictions, (unsigned)s.peakBytes,
+           (unsigned)peakHeap, (unsigned)budget);
+    CHECK(peakHeap <= budget + pageBytes[lessons - 1] + (LESSON_CACHE_SLOTS + 1) * 16);
+
+    cache.clear();
+    CHECK(cache.getStats().bytes == 0);
+    CHECK(liveBytes == baseline);
+  }
+  return checkResult("test_lesson_cache");
+}
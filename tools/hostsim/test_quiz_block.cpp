@@ -0,0 +1,108 @@
+// test_quiz_block: quiz blocks round-trip through quizBlockEncode and
+// quizBlockDecode for every option count, from none to z), and up to
+// exactly QUIZ_BLOCK_MAX bytes; blocks that are truncated, damaged or read
+// with the wrong option count are refused.
+
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "content_format.h"
+
+static bool same(TextSpan s, const std::string& text) {
+  return s.len == text.size() && memcmp(s.ptr, text.data(), s.len) == 0;
+}
+
+// Encodes question and options, decodes the block again and compares.
+// Returns the block length, 0 if it was not encoded.
+static size_t roundTrip(const std::string& question, const std::vector<std::string>& options, std::string& block) {
+  TextSpan spans[QUIZ_OPTION_LETTERS];
+  QuizQuestionSpans q;
+  q.question = TextSpan(question.data(), question.size());
+  q.optionCount = (int)options.size();
+  for (size_t i = 0; i < options.size(); i++) spans[i] = TextSpan(options[i].data(), options[i].size());
+  q.spans = spans;
+
+  char buf[QUIZ_BLOCK_MAX + 64];
+  size_t len = quizBlockEncode(q, buf, sizeof(buf));
+  block.assign(buf, len);
+  if (!len) return 0;
+
+  QuizQuestionSpans d;
+  d.correctAnswer = 'c';
+  CHECK(quizBlockDecode(block.data(), len, q.optionCount, d));
+  CHECK(d.optionCount == q.optionCount);
+  CHECK(d.correctAnswer == 'c');  // kept beside the block, left alone
+  CHECK(same(d.question, question));
+  for (size_t i = 0; i < options.size(); i++) CHECK(same(d.option((int)i), options[i]));
+  return len;
+}
+
+int main() {
+  std::string block;
+
+  // No options: the table is the question's end alone
+  CHECK(roundTrip("Is this a question?", {}, block) == 2 + 19);
+  CHECK(roundTrip("", {}, block) == 2);
+
+  // The example in content_format.h, byte for byte
+  CHECK(roundTrip("Largest island?", {"Cebu", "Luzon"}, block) == 6 + 24);
+  CHECK(block.substr(0, 6) == std::string("\x0F\0\x13\0\x18\0", 6));
+
+  // Every option count, with empty, UTF-8 and repeated option texts
+  for (int n = 1; n <= QUIZ_OPTION_LETTERS; n++) {
+    std::vector<std::string> options;
+    for (int i = 0; i < n; i++) {
+      if (i % 7 == 3) options.push_back("");
+      else if (i % 7 == 5) options.push_back("Muñoz, Nueva Écija");
+      else options.push_back(std::string(1 + i % 4, (char)('a' + i)));
+    }
+    CHECK(roundTrip("Which one?", options, block) == quizBlockTableSize(n) + 10 + [&] {
+      size_t t = 0;
+      for (const std::string& o : options) t += o.size();
+      return t;
+    }());
+  }
+
+  // Exactly QUIZ_BLOCK_MAX bytes fits; one more does not
+  std::vector<std::string> four = {"one", "two", "three", "four"};
+  size_t rest = QUIZ_BLOCK_MAX - quizBlockTableSize(4) - 3 - 3 - 5 - 4;
+  CHECK(roundTrip(std::string(rest, 'q'), four, block) == QUIZ_BLOCK_MAX);
+  CHECK(roundTrip(std::string(rest + 1, 'q'), four, block) == 0);
+  std::string oversized(QUIZ_BLOCK_MAX + 1, '\0');
+  QuizQuestionSpans d;
+  CHECK(!quizBlockDecode(oversized.data(), oversized.size(), 0, d));
+
+  // A buffer too small for the block
+  {
+    QuizQuestionSpans q;
+    q.question = TextSpan("Too long", 8);
+    char buf[10];
+    CHECK(quizBlockEncode(q, buf, 9) == 0);
+    CHECK(quizBlockEncode(q, buf, sizeof(buf)) == 10);
+  }
+
+  // Every truncation of a block is refused, down to an empty one
+  CHECK(roundTrip("Capital of Cebu?", {"Cebu City", "Mandaue", "Lapu-Lapu"}, block) > 0);
+  for (size_t len = 0; len < block.size(); len++) CHECK(!quizBlockDecode(block.data(), len, 3, d));
+
+  // So is a block read with the wrong option count, or one out of range
+  CHECK(!quizBlockDecode(block.data(), block.size(), 2, d));
+  CHECK(!quizBlockDecode(block.data(), block.size(), -1, d));
+  CHECK(!quizBlockDecode(block.data(), block.size(), QUIZ_OPTION_LETTERS + 1, d));
+
+  // ...and one whose offsets run backwards or past its text
+  std::string damaged = block;
+  std::swap(damaged[2], damaged[4]);
+  CHECK(!quizBlockDecode(damaged.data(), damaged.size(), 3, d));
+  damaged = block;
+  damaged[7] = 0x7F;
+  CHECK(!quizBlockDecode(damaged.data(), damaged.size(), 3, d));
+
+  // A refused decode leaves q as it was
+  d.question = TextSpan("kept", 4);
+  d.optionCount = 9;
+  CHECK(!quizBlockDecode(block.data(), block.size() - 1, 3, d));
+  CHECK(same(d.question, "kept") && d.optionCount == 9);
+  return checkResult("test_quiz_block");
+}
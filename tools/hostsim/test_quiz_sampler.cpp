@@ -0,0 +1,144 @@
+// test_quiz_sampler: an attempt never asks a question twice and only asks
+// questions of the bank; the same seed draws the same attempt, option order
+// included; a bank smaller than QUIZ_SAMPLE_SIZE is asked whole, and seed 0
+// asks it as written. Graded answers are counted against the bank question
+// and file option that were shown, as handleQuizSubmit counts them.
+
+#include <vector>
+
+#include "check.h"
+#include "quiz_sampler.h"
+#include "quiz_stats.h"
+
+// Question i of a test bank has 2 + i % 5 options; the right one is i % that.
+static int options(uint16_t i) { return 2 + i % 5; }
+static int rightOption(uint32_t i) { return (int)(i % options((uint16_t)i)); }
+
+// Whether sample asks distinct questions, all inside a bank of size bank.
+static bool distinctInBank(const QuizSampler& sample, uint32_t bank) {
+  std::vector<bool> asked(bank, false);
+  for (uint32_t i = 0; i < sample.size(); i++) {
+    uint32_t q = sample.question(i);
+    if (q >= bank || asked[q]) return false;
+    asked[q] = true;
+  }
+  return true;
+}
+
+// Whether order holds each of 0 to n - 1 once.
+static bool isOrder(const uint8_t* order, int n) {
+  std::vector<bool> seen(n, false);
+  for (int i = 0; i < n; i++) {
+    if (order[i] >= n || seen[order[i]]) return false;
+    seen[order[i]] = true;
+  }
+  return true;
+}
+
+int main() {
+  // Every bank size around the sample size and the Feistel widths, many seeds
+  const uint32_t seeds[] = {1, 2, 7, 0x9e3779b9u, 0xFFFFFFFFu, 123456789u};
+  for (uint32_t bank = 1; bank <= 300; bank++) {
+    for (uint32_t seed : seeds) {
+      QuizSampler sample(seed, bank, QUIZ_SAMPLE_SIZE);
+      CHECK(sample.size() == (bank < QUIZ_SAMPLE_SIZE ? bank : QUIZ_SAMPLE_SIZE));
+      CHECK(distinctInBank(sample, bank));
+    }
+  }
+  for (uint32_t bank : {1000u, 4097u, 65535u}) {
+    QuizSampler sample(42, bank, QUIZ_SAMPLE_SIZE);
+    CHECK(distinctInBank(sample, bank));
+    QuizSampler whole(42, bank, bank);  // A sample of the whole bank is a shuffle
+    CHECK(whole.size() == bank && distinctInBank(whole, bank));
+  }
+
+  // A bank smaller than the sample is asked whole, shuffled
+  {
+    QuizSampler sample(5, 8, QUIZ_SAMPLE_SIZE);
+    CHECK(sample.size() == 8 && distinctInBank(sample, 8));
+    bool moved = false;
+    for (uint32_t i = 0; i < 8; i++) moved |= sample.question(i) != i;
+    CHECK(moved);
+  }
+
+  // Seed 0 asks the whole bank in file order, options as written
+  {
+    QuizSampler sample(0, 50, QUIZ_SAMPLE_SIZE);
+    CHECK(sample.size() == 50);
+    for (uint32_t i = 0; i < 50; i++) CHECK(sample.question(i) == i);
+    uint8_t order[QUIZ_OPTION_LETTERS];
+    sample.options(3, 4, order);
+    CHECK(order[0] == 0 && order[1] == 1 && order[2] == 2 && order[3] == 3);
+  }
+
+  // The same seed draws the same attempt; another seed another one
+  {
+    QuizSampler a(777, 500, QUIZ_SAMPLE_SIZE), b(777, 500, QUIZ_SAMPLE_SIZE), c(778, 500, QUIZ_SAMPLE_SIZE);
+    bool differs = false;
+    for (uint32_t i = 0; i < a.size(); i++) {
+      CHECK(a.question(i) == b.question(i));
+      differs |= a.question(i) != c.question(i);
+      uint8_t oa[QUIZ_OPTION_LETTERS], ob[QUIZ_OPTION_LETTERS];
+      a.options(i, 6, oa);
+      b.options(i, 6, ob);
+      CHECK(isOrder(oa, 6) && memcmp(oa, ob, 6) == 0);
+    }
+    CHECK(differs);
+    uint8_t order[QUIZ_OPTION_LETTERS];
+    a.options(0, QUIZ_OPTION_LETTERS, order);
+    CHECK(isOrder(order, QUIZ_OPTION_LETTERS));
+  }
+
+  // Grading: each answer is counted against the bank question shown at its
+  // position and the file option behind the letter picked
+  {
+    const uint16_t bank = 120;
+    QuizStatsTable table;
+    QuizStats* stats = table.open(1, bank, options);
+    CHECK(stats != nullptr);
+    if (!stats) return checkResult("test_quiz_sampler");
+
+    QuizSampler sample(31337, bank, QUIZ_SAMPLE_SIZE);
+    std::vector<int> expectedRight(bank, 0), expectedPick(bank, -1);
+    std::vector<char> answers(sample.size());
+    for (uint32_t i = 0; i < sample.size(); i++) {
+      uint32_t q = sample.question(i);
+      int n = options((uint16_t)q);
+      uint8_t order[QUIZ_OPTION_LETTERS];
+      sample.options(i, n, order);
+      // Even positions answer right, odd ones pick the first option shown
+      int place = 0;
+      if (i % 2 == 0) while (order[place] != rightOption(q)) place++;
+      answers[i] = (char)('a' + place);
+      expectedPick[q] = order[place];
+      expectedRight[q] = order[place] == rightOption(q);
+    }
+
+    int score = 0;
+    for (uint32_t i = 0; i < sample.size(); i++) {
+      uint32_t index = sample.question(i);
+      int option = sample.pick(i, options((uint16_t)index), answers[i]);
+      CHECK(option == expectedPick[index]);
+      bool right = option == rightOption(index);
+      QuizStatsTable::record(*stats, index, option, right);
+      score += right;
+    }
+    CHECK(score >= (int)(sample.size() + 1) / 2);
+
+    for (uint16_t q = 0; q < bank; q++) {
+      uint32_t attempts = 0;
+      for (int j = 0; j < options(q); j++) {
+        attempts += stats->picks(q)[j];
+        CHECK(stats->picks(q)[j] == (uint32_t)(j == expectedPick[q]));
+      }
+      CHECK(attempts == (expectedPick[q] >= 0 ? 1u : 0u));  // Questions not asked stay at zero
+      CHECK(stats->correct(q) == (uint32_t)expectedRight[q]);
+    }
+
+    // Letters past the options shown, or not letters at all, pick nothing
+    uint32_t q0 = sample.question(0);
+    CHECK(sample.pick(0, options((uint16_t)q0), (char)('a' + options((uint16_t)q0))) == -1);
+    CHECK(sample.pick(0, options((uint16_t)q0), '-') == -1);
+  }
+  return checkResult("test_quiz_sampler");
+}
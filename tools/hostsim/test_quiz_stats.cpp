@@ -0,0 +1,56 @@
+// test_quiz_stats: counters keyed by bank index, sized to each question's
+// options, within QUIZ_STATS_BYTES across modules: modules submitted to
+// least recently make room, and a bank over the whole budget is counted up
+// to the question that fills it.
+
+#include "check.h"
+#include "quiz_stats.h"
+
+// Question i of a bank has 2 + i % 5 options.
+static int options(uint16_t i) { return 2 + i % 5; }
+
+int main() {
+  QuizStatsTable table;
+
+  // A small bank: every question counted, each with its own option count
+  QuizStats* small = table.open(1, 10, options);
+  CHECK(small != nullptr);
+  CHECK(small->questionCount == 10);
+  for (int i = 0; i < 10; i++) CHECK(small->optionCount(i) == options(i));
+  QuizStatsTable::record(*small, 3, 4, true);
+  QuizStatsTable::record(*small, 3, 1, false);
+  QuizStatsTable::record(*small, 3, 5, false);   // question 3 has options 0-4
+  QuizStatsTable::record(*small, 10, 0, false);  // past the bank
+  CHECK(small->correct(3) == 1);
+  CHECK(small->picks(3)[4] == 1 && small->picks(3)[1] == 1);
+  CHECK(small->picks(2)[0] == 0 && small->correct(4) == 0);
+  CHECK(table.open(1, 10, options) == small);
+
+  // A bank larger than the budget: counted up to the question that fills it
+  size_t words;
+  uint16_t fit = QuizStatsTable::countable(60000, options, words);
+  CHECK(fit > 0 && fit < 60000);
+  CHECK(words * sizeof(uint32_t) <= QUIZ_STATS_BYTES);
+  CHECK((words + 2 + options(fit)) * sizeof(uint32_t) > QUIZ_STATS_BYTES);
+
+  // ...which takes the whole budget, so the small bank makes room
+  QuizStats* big = table.open(2, 60000, options);
+  CHECK(big != nullptr);
+  CHECK(big->questionCount == fit);
+  CHECK(table.find(1) == nullptr);
+  CHECK(table.getEvictions() == 1);
+  CHECK(table.getBytes() == words * sizeof(uint32_t));
+  QuizStatsTable::record(*big, fit - 1, 0, true);
+  QuizStatsTable::record(*big, fit, 0, true);  // uncounted, ignored
+  CHECK(big->correct(fit - 1) == 1);
+
+  // Many small banks share the budget; the least recently used goes first
+  QuizStats* again = table.open(1, 10, options);
+  CHECK(again != nullptr && table.find(2) == nullptr);
+  for (uint32_t key = 3; key < 3 + QUIZ_STATS_MODULES; key++) CHECK(table.open(key, 10, options) != nullptr);
+  CHECK(table.find(1) == nullptr);
+  CHECK(table.find(3 + QUIZ_STATS_MODULES - 1) != nullptr);
+  CHECK(table.getBytes() <= QUIZ_STATS_BYTES);
+
+  return checkResult("test_quiz_stats");
+}
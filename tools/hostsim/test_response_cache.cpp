@@ -0,0 +1,124 @@
+// test_response_cache: a page being sent with openBody() stays in place
+// while its response runs: it is not evicted, and a content reload frees
+// it only once the response is done, still counted until then. A page that
+// does not compress holds no buffer for the gzip copy it tried to make.
+
+#include <stdlib.h>
+#include <new>
+#include <string>
+
+#include "Arduino.h"
+#include "check.h"
+#include "response_cache.h"
+
+// Heap held through operator new, which is where String keeps its bytes
+static size_t liveBytes = 0;
+
+void* operator new(size_t n) {
+  size_t* p = (size_t*)malloc(n + 16);
+  if (!p) throw std::bad_alloc();
+  *p = n;
+  liveBytes += n;
+  return (char*)p + 16;
+}
+
+void operator delete(void* ptr) noexcept {
+  if (!ptr) return;
+  size_t* p = (size_t*)((char*)ptr - 16);
+  liveBytes -= *p;
+  free(p);
+}
+
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+
+static String page(char c, size_t n) {
+  String s;
+  s.reserve(n);
+  for (size_t i = 0; i < n; i++) s += (char)(c + i % 7);
+  return s;
+}
+
+// Bytes from 1 to 255 in no order, which the gzip writer only makes larger
+static String noise(size_t n) {
+  String s;
+  s.reserve(n);
+  uint32_t x = 12345;
+  for (size_t i = 0; i < n; i++) {
+    x = x * 1103515245u + 12345u;
+    s += (char)(1 + (x >> 16) % 255);
+  }
+  return s;
+}
+
+// Reads all of body in pieces of cap bytes, as the engine does, and closes it.
+static std::string readAll(HttpBodySource& body, size_t cap) {
+  std::string got;
+  char buf[64];
+  while (body.remaining > 0) {
+    size_t n = body.read(body.ctx, buf, cap);
+    if (n == 0) break;
+    got.append(buf, n);
+    body.remaining -= n;
+  }
+  body.close(body.ctx);
+  return got;
+}
+
+int main() {
+  const size_t budget = 4096;
+  ResponseCache cache(budget);
+
+  String a = page('a', 1500);
+  std::string aText(a.c_str(), a.length());
+  const CachedResponse* entry = cache.put("/a", a);
+  CHECK(entry != nullptr);
+  size_t entryBytes = cache.getStats().bytes;
+
+  // A body reads the stored page in any piece size
+  HttpBodySource body;
+  CHECK(cache.openBody(*entry, false, body));
+  CHECK(body.remaining == aText.size());
+  CHECK(readAll(body, 64) == aText);
+
+  // While it is being sent, the page is not evicted to make room
+  CHECK(cache.openBody(*entry, false, body));
+  for (char c = 'b'; c < 'k'; c++) {
+    String other = page(c, 1200);
+    cache.put(String("/") + c, other);
+    CHECK(cache.getStats().bytes <= budget);
+  }
+  CHECK(cache.peek("/a") == entry);
+
+  // A reload drops it from lookups but keeps its bytes, still counted, until
+  // the response is done
+  cache.clear();
+  CHECK(cache.peek("/a") == nullptr);
+  CHECK(cache.getStats().bytes == entryBytes);
+  String b = page('b', 3000);
+  CHECK(cache.put("/b", b) == nullptr);  // does not fit next to it
+  CHECK(readAll(body, 50) == aText);
+  CHECK(cache.getStats().bytes == 0);
+  CHECK(entry->body.length() == 0);
+  String again = page('b', 3000);
+  CHECK(cache.put("/b", again) != nullptr);
+  cache.clear();
+
+  // A page that does not compress keeps only its body, and the buffer
+  // reserved for the copy is freed rather than left in the entry
+  String n = noise(2000);
+  size_t before = liveBytes;
+  entry = cache.put("/n", n);
+  CHECK(entry != nullptr && entry->gzip.length() == 0 && entry->body.length() == 2000);
+  CHECK(cache.getStats().bytes == 2 + 2000);
+  CHECK(liveBytes - before < 200);  // The key; the body was moved in
+  cache.clear();
+  CHECK(cache.getStats().bytes == 0);
+
+  // Without keepPlain a page that compresses keeps only the gzip copy
+  String c = page('c', 2000);
+  entry = cache.put("/c", c, false);
+  CHECK(entry != nullptr && entry->body.length() == 0);
+  CHECK(entry->gzip.length() > 0 && entry->gzip.length() < 2000);
+  CHECK(cache.getStats().bytes == 2 + entry->gzip.length());
+  return checkResult("test_response_cache");
+}